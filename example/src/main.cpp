@@ -26,7 +26,10 @@
 	#include "OSX/macUtils.h"
 #endif
 
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <sstream>
 
 
 #define Q(x) #x
@@ -69,6 +72,11 @@ static void register_hlms(Ogre::ConfigFile& cf, const Ogre::String& resourcePath
 				"FileSystem",
 				true));
 		}
+		// Rounded clip masks, clipped to in the pixel shader
+		archiveLibraryFolders.push_back(archiveManager.load(
+			QUOTE(RMLOGRE_MEDIA_DIR) "/Hlms/Unlit/Any",
+			"FileSystem",
+			true));
 
 		// Create and register the unlit Hlms
 		hlmsUnlit = OGRE_NEW HlmsUnlit(archive, &archiveLibraryFolders);
@@ -339,6 +347,32 @@ int main( int argc, const char *argv[] )
 
 	auto resolution = Rml::Vector2i(window->getWidth(), window->getHeight());
 	nimble::RmlOgre::RenderInterface renderInterface("Ui", sceneManager, window->getTexture(), sceneTexture);
+
+	// RMLOGRE_BLUR=dual|dual-medium|dual-low to compare against the Gaussian blur
+	if(const char* blur = std::getenv("RMLOGRE_BLUR"))
+	{
+		nimble::RmlOgre::BlurSettings blurSettings;
+		if(std::strncmp(blur, "dual", 4) == 0)
+			blurSettings.mode = nimble::RmlOgre::BlurMode::Dual;
+		if(std::strstr(blur, "-medium"))
+			blurSettings.quality = nimble::RmlOgre::BlurQuality::Medium;
+		else if(std::strstr(blur, "-low"))
+			blurSettings.quality = nimble::RmlOgre::BlurQuality::Low;
+		renderInterface.SetBlurSettings(blurSettings);
+	}
+
+	// Texture dimensions from previous runs, so textures load without waiting
+	// and small images can be packed into the texture atlas
+	const String textureMetadataPath = writeAccessFolder + "texture_metadata.txt";
+	{
+		std::ifstream textureMetadata(textureMetadataPath);
+		std::stringstream stream;
+		stream << textureMetadata.rdbuf();
+		renderInterface.ImportTextureMetadata(stream.str());
+	}
+	// RMLOGRE_TEXTURE_ATLAS=<size> to pack images no larger than size, from the second run
+	if(const char* atlas = std::getenv("RMLOGRE_TEXTURE_ATLAS"))
+		renderInterface.SetTextureAtlasThreshold(std::strtoul(atlas, nullptr, 10));
 	Rml::Context* context = Rml::CreateContext(
 		"Main",
 		resolution,
@@ -370,6 +404,8 @@ int main( int argc, const char *argv[] )
 
 	WindowEventUtilities::removeWindowEventListener(window, &myWindowEventListener);
 
+	std::ofstream(textureMetadataPath) << renderInterface.ExportTextureMetadata();
+
 	Rml::Shutdown();
 
 	return 0;
@@ -0,0 +1,24 @@
+#version ogre_glsl_ver_330
+
+vulkan_layout( ogre_t1 ) uniform texture2D cacheTex;
+
+vulkan( layout( ogre_s1 ) uniform sampler texSampler );
+
+vulkan( layout( ogre_P0 ) uniform Params { )
+	// Normalised position and size of the cached texture on the target
+	uniform vec4 region;
+vulkan( }; )
+
+vulkan_layout( location = 0 )
+in block
+{
+	vec2 uv0;
+} inPs;
+
+vulkan_layout( location = 0 )
+out vec4 fragColour;
+
+void main()
+{
+	fragColour = texture( vkSampler2D( cacheTex, texSampler ), (inPs.uv0 - region.xy) / region.zw );
+}
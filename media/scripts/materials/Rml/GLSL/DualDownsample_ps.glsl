@@ -0,0 +1,32 @@
+#version ogre_glsl_ver_330
+
+vulkan_layout( ogre_t0 ) uniform texture2D srcTex;
+
+vulkan( layout( ogre_s0 ) uniform sampler texSampler );
+
+vulkan( layout( ogre_P0 ) uniform Params { )
+	uniform vec4 viewportSize;
+	uniform float offset;
+vulkan( }; )
+
+vulkan_layout( location = 0 )
+in block
+{
+	vec2 uv0;
+} inPs;
+
+vulkan_layout( location = 0 )
+out vec4 fragColour;
+
+void main()
+{
+	vec2 d = viewportSize.zw * offset;
+
+	vec4 colour = texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 ) * 4.0;
+	colour += texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 - d );
+	colour += texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 + d );
+	colour += texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 + vec2( d.x, -d.y ) );
+	colour += texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 - vec2( d.x, -d.y ) );
+
+	fragColour = colour * 0.125;
+}
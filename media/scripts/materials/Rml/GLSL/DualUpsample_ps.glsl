@@ -0,0 +1,36 @@
+#version ogre_glsl_ver_330
+
+vulkan_layout( ogre_t0 ) uniform texture2D srcTex;
+
+vulkan( layout( ogre_s0 ) uniform sampler texSampler );
+
+vulkan( layout( ogre_P0 ) uniform Params { )
+	uniform vec4 viewportSize;
+	uniform float offset;
+vulkan( }; )
+
+vulkan_layout( location = 0 )
+in block
+{
+	vec2 uv0;
+} inPs;
+
+vulkan_layout( location = 0 )
+out vec4 fragColour;
+
+void main()
+{
+	vec2 d = viewportSize.zw * offset;
+	vec2 h = d * 0.5;
+
+	vec4 colour = texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 + vec2( -d.x, 0.0 ) );
+	colour += texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 + vec2( d.x, 0.0 ) );
+	colour += texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 + vec2( 0.0, -d.y ) );
+	colour += texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 + vec2( 0.0, d.y ) );
+	colour += texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 + vec2( -h.x, -h.y ) ) * 2.0;
+	colour += texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 + vec2( h.x, -h.y ) ) * 2.0;
+	colour += texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 + vec2( -h.x, h.y ) ) * 2.0;
+	colour += texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 + vec2( h.x, h.y ) ) * 2.0;
+
+	fragColour = colour / 12.0;
+}
@@ -1,22 +1,23 @@
 #version ogre_glsl_ver_330
 
-#define MAX_STOP_COLOURS 16
-// MAX_STOP_POSITIONS = MAX_STOP_COLOURS / 4
-#define MAX_STOP_POSITIONS 4
+// Must be same as GradientAtlas::LUT_WIDTH in src/RmlOgre/GradientAtlas.hpp
+#define LUT_WIDTH 512.0
+
+// One of LINEAR_GRADIENT, RADIAL_GRADIENT or CONIC_GRADIENT, and optionally REPEATING
+// are defined by the program definitions in Gradient.material
 
-const int LINEAR_GRADIENT = 0;
-const int RADIAL_GRADIENT = 1;
-const int CONIC_GRADIENT = 2;
 const float PI = 3.14159265;
 
+vulkan_layout( ogre_t0 ) uniform texture2D lutTex;
+
+vulkan( layout( ogre_s0 ) uniform sampler lutSampler );
+
 vulkan( layout( ogre_P0 ) uniform Params { )
-	uniform int gradientType;
-	uniform int repeating;
-	uniform vec2 origin;
-	uniform vec2 scale;
-	uniform int numStops;
-	uniform vec4 stopPositions[MAX_STOP_POSITIONS];
-	uniform vec4 stopColours[MAX_STOP_COLOURS];
+	// Set for each draw
+	// xy: origin, zw: scale
+	uniform vec4 gradient;
+	// x: position of the first stop, y: 1 / stop position range, z: v coordinate of the lookup table
+	uniform vec4 lut;
 vulkan( }; )
 
 vulkan_layout( location = 0 )
@@ -29,27 +30,6 @@ in block
 vulkan_layout( location = 0 )
 out vec4 fragColour;
 
-float get_stop_position(int i)
-{
-	int y = i >> 2;
-	int x = i & 3;
-	return stopPositions[y][x];
-}
-
-vec4 mix_stop_colours(float t)
-{
-	vec4 colour = stopColours[0];
-	for(int i = 1; i < numStops; ++i)
-	{
-		colour = mix(
-			colour,
-			stopColours[i],
-			smoothstep(get_stop_position(i - 1), get_stop_position(i), t));
-	}
-
-	return colour;
-}
-
 float linear_gradient(vec2 origin, vec2 scale, vec2 p)
 {
 	return dot(scale, p - origin) / dot(scale, scale);
@@ -69,20 +49,20 @@ float conic_gradient(vec2 origin, vec2 scale, vec2 p)
 
 void main()
 {
-	float t = 0.0;
-	if(gradientType == LINEAR_GRADIENT)
-		t = linear_gradient(origin, scale, inPs.uv0);
-	else if(gradientType == RADIAL_GRADIENT)
-		t = radial_gradient(origin, scale, inPs.uv0);
-	else if(gradientType == CONIC_GRADIENT)
-		t = conic_gradient(origin, scale, inPs.uv0);
+#if defined(LINEAR_GRADIENT)
+	float t = linear_gradient(gradient.xy, gradient.zw, inPs.uv0);
+#elif defined(RADIAL_GRADIENT)
+	float t = radial_gradient(gradient.xy, gradient.zw, inPs.uv0);
+#elif defined(CONIC_GRADIENT)
+	float t = conic_gradient(gradient.xy, gradient.zw, inPs.uv0);
+#endif
 
-	if(repeating != 0)
-	{
-		float t0 = get_stop_position(0);
-		float t1 = get_stop_position(numStops - 1);
-		t = t0 + mod(t - t0, t1 - t0);
-	}
+	t = (t - lut.x) * lut.y;
+#ifdef REPEATING
+	t = fract(t);
+#endif
 
-	fragColour = inPs.colour * mix_stop_colours(t);
+	// Positions outside the stops are clamped by the sampler
+	float u = (t * (LUT_WIDTH - 1.0) + 0.5) / LUT_WIDTH;
+	fragColour = inPs.colour * texture( vkSampler2D( lutTex, lutSampler ), vec2( u, lut.z ) );
 }
@@ -1,9 +1,18 @@
 #version ogre_glsl_ver_330
 
+// RED_MASK is defined by the Rml/MaskRed_ps program definitions in Mask.material,
+// for single channel mask images which keep their alpha in the red channel
+
 vulkan_layout( ogre_t0 ) uniform texture2D dstTex;
 vulkan_layout( ogre_t1 ) uniform texture2D srcTex;
 
 vulkan( layout( ogre_s0 ) uniform sampler texSampler );
+vulkan( layout( ogre_s1 ) uniform sampler maskSampler );
+
+vulkan( layout( ogre_P0 ) uniform Params { )
+	// Fraction of dstTex used, from its top left
+	uniform vec2 maskScale;
+vulkan( }; )
 
 vulkan_layout( location = 0 )
 in block
@@ -16,7 +25,11 @@ out vec4 fragColour;
 
 void main()
 {
-	vec4 dst = texture( vkSampler2D( dstTex, texSampler ), inPs.uv0 );
-	vec4 src = texture( vkSampler2D( srcTex, texSampler ), inPs.uv0 );
+	vec4 dst = texture( vkSampler2D( dstTex, texSampler ), inPs.uv0 * maskScale );
+	vec4 src = texture( vkSampler2D( srcTex, maskSampler ), inPs.uv0 );
+#if RED_MASK
+	fragColour = dst * src.r;
+#else
 	fragColour = dst * src.a;
+#endif
 }
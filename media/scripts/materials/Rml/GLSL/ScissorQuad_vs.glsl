@@ -6,6 +6,8 @@ vulkan_layout( OGRE_TEXCOORD0 ) in vec2 uv0;
 vulkan( layout( ogre_P0 ) uniform Params { )
 	uniform mat4 worldViewProj;
 	uniform vec4 scissorRegion;
+	// Fraction of the target drawn to, from its top left
+	uniform vec2 targetSize;
 vulkan( }; )
 
 out gl_PerVertex
@@ -21,6 +23,7 @@ out block
 
 void main()
 {
-	gl_Position = worldViewProj * vec4( vertex, 1.0 );
+	vec2 position = ( vertex.xy - vec2( -1.0, 1.0 ) ) * targetSize + vec2( -1.0, 1.0 );
+	gl_Position = worldViewProj * vec4( position, vertex.z, 1.0 );
 	outVs.uv0.xy = scissorRegion.xy + uv0 * scissorRegion.zw;
 }
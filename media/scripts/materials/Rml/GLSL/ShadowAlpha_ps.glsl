@@ -0,0 +1,35 @@
+#version ogre_glsl_ver_330
+
+vulkan_layout( ogre_t0 ) uniform texture2D srcTex;
+
+vulkan( layout( ogre_s0 ) uniform sampler texSampler );
+
+vulkan( layout( ogre_P0 ) uniform Params { )
+	uniform vec4 viewportSize;
+	// Bilinear taps along each axis, each tap averages 2x2 texels
+	uniform float taps;
+vulkan( }; )
+
+vulkan_layout( location = 0 )
+in block
+{
+	vec2 uv0;
+} inPs;
+
+vulkan_layout( location = 0 )
+out vec4 fragColour;
+
+void main()
+{
+	int n = int( taps );
+	vec2 start = inPs.uv0 - viewportSize.zw * (taps - 1.0);
+
+	float a = 0.0;
+	for( int y = 0; y < n; ++y )
+	{
+		for( int x = 0; x < n; ++x )
+			a += texture( vkSampler2D( srcTex, texSampler ), start + vec2( x, y ) * 2.0 * viewportSize.zw ).a;
+	}
+
+	fragColour = vec4( a / (taps * taps) );
+}
@@ -0,0 +1,32 @@
+#version ogre_glsl_ver_330
+
+vulkan_layout( ogre_t0 ) uniform texture2D srcTex;
+vulkan_layout( ogre_t1 ) uniform texture2D shadowTex;
+
+vulkan( layout( ogre_s0 ) uniform sampler srcSampler );
+vulkan( layout( ogre_s1 ) uniform sampler shadowSampler );
+
+vulkan( layout( ogre_P0 ) uniform Params { )
+	uniform vec4 viewportSize;
+	uniform vec4 colour;
+	uniform vec2 offset;
+	// Resolution of the shadow relative to the source
+	uniform float scale;
+vulkan( }; )
+
+vulkan_layout( location = 0 )
+in block
+{
+	vec2 uv0;
+} inPs;
+
+vulkan_layout( location = 0 )
+out vec4 fragColour;
+
+void main()
+{
+	vec4 primary = texture( vkSampler2D( srcTex, srcSampler ), inPs.uv0 );
+	vec2 shadowUv = (inPs.uv0 - offset * viewportSize.zw) * scale;
+	float shadowA = texture( vkSampler2D( shadowTex, shadowSampler ), shadowUv ).r;
+	fragColour = primary + colour * shadowA * (1 - primary.a);
+}
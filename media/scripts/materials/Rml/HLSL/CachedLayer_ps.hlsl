@@ -0,0 +1,18 @@
+Texture2D    cacheTex : register(t1);
+SamplerState mySampler : register(s1);
+
+// Normalised position and size of the cached texture on the target
+uniform float4 region;
+
+struct PS_INPUT
+{
+	float2 uv0 : TEXCOORD0;
+};
+
+float4 main
+(
+	PS_INPUT inPs
+) : SV_Target
+{
+	return cacheTex.Sample( mySampler, (inPs.uv0 - region.xy) / region.zw );
+}
@@ -0,0 +1,15 @@
+Texture2D    srcTex : register(t0);
+SamplerState mySampler : register(s0);
+
+struct PS_INPUT
+{
+	float2 uv0 : TEXCOORD0;
+};
+
+float4 main
+(
+	PS_INPUT inPs
+) : SV_Target
+{
+	return srcTex.Sample( mySampler, inPs.uv0 ).a;
+}
@@ -0,0 +1,26 @@
+Texture2D    srcTex : register(t0);
+SamplerState mySampler : register(s0);
+
+uniform float4 viewportSize;
+uniform float offset;
+
+struct PS_INPUT
+{
+	float2 uv0 : TEXCOORD0;
+};
+
+float4 main
+(
+	PS_INPUT inPs
+) : SV_Target
+{
+	float2 d = viewportSize.zw * offset;
+
+	float4 colour = srcTex.Sample( mySampler, inPs.uv0 ) * 4.0;
+	colour += srcTex.Sample( mySampler, inPs.uv0 - d );
+	colour += srcTex.Sample( mySampler, inPs.uv0 + d );
+	colour += srcTex.Sample( mySampler, inPs.uv0 + float2( d.x, -d.y ) );
+	colour += srcTex.Sample( mySampler, inPs.uv0 - float2( d.x, -d.y ) );
+
+	return colour * 0.125;
+}
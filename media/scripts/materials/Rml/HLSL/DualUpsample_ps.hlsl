@@ -0,0 +1,30 @@
+Texture2D    srcTex : register(t0);
+SamplerState mySampler : register(s0);
+
+uniform float4 viewportSize;
+uniform float offset;
+
+struct PS_INPUT
+{
+	float2 uv0 : TEXCOORD0;
+};
+
+float4 main
+(
+	PS_INPUT inPs
+) : SV_Target
+{
+	float2 d = viewportSize.zw * offset;
+	float2 h = d * 0.5;
+
+	float4 colour = srcTex.Sample( mySampler, inPs.uv0 + float2( -d.x, 0.0 ) );
+	colour += srcTex.Sample( mySampler, inPs.uv0 + float2( d.x, 0.0 ) );
+	colour += srcTex.Sample( mySampler, inPs.uv0 + float2( 0.0, -d.y ) );
+	colour += srcTex.Sample( mySampler, inPs.uv0 + float2( 0.0, d.y ) );
+	colour += srcTex.Sample( mySampler, inPs.uv0 + float2( -h.x, -h.y ) ) * 2.0;
+	colour += srcTex.Sample( mySampler, inPs.uv0 + float2( h.x, -h.y ) ) * 2.0;
+	colour += srcTex.Sample( mySampler, inPs.uv0 + float2( -h.x, h.y ) ) * 2.0;
+	colour += srcTex.Sample( mySampler, inPs.uv0 + float2( h.x, h.y ) ) * 2.0;
+
+	return colour / 12.0;
+}
@@ -1,25 +1,19 @@
-static const int MAX_STOP_COLOURS = 16;
-// MAX_STOP_POSITIONS = MAX_STOP_COLOURS / 4
-static const int MAX_STOP_POSITIONS = 4;
+// Must be same as GradientAtlas::LUT_WIDTH in src/RmlOgre/GradientAtlas.hpp
+static const float LUT_WIDTH = 512.0;
 
-static const int LINEAR_GRADIENT = 0;
-static const int RADIAL_GRADIENT = 1;
-static const int CONIC_GRADIENT = 2;
-static const float PI = 3.14159265;
+// One of LINEAR_GRADIENT, RADIAL_GRADIENT or CONIC_GRADIENT, and optionally REPEATING
+// are defined by the program definitions in Gradient.material
 
-// glsl style mod
-#define mod(x, y) (x - y * floor(x / y))
+static const float PI = 3.14159265;
 
-Texture2D    srcTex : register(t0);
-SamplerState mySampler : register(s0);
+Texture2D    lutTex : register(t0);
+SamplerState lutSampler : register(s0);
 
-uniform int gradientType;
-uniform int repeating;
-uniform float2 origin;
-uniform float2 scale;
-uniform int numStops;
-uniform float4 stopPositions[MAX_STOP_POSITIONS];
-uniform float4 stopColours[MAX_STOP_COLOURS];
+// Set for each draw
+// xy: origin, zw: scale
+uniform float4 gradient;
+// x: position of the first stop, y: 1 / stop position range, z: v coordinate of the lookup table
+uniform float4 lut;
 
 struct PS_INPUT
 {
@@ -28,27 +22,6 @@ struct PS_INPUT
 	//float4 gl_Position : SV_POSITION;
 };
 
-float get_stop_position(int i)
-{
-	int y = i >> 2;
-	int x = i & 3;
-	return stopPositions[y][x];
-}
-
-float4 mix_stop_colours(float t)
-{
-	float4 colour = stopColours[0];
-	for(int i = 1; i < numStops; ++i)
-	{
-		colour = lerp(
-			colour,
-			stopColours[i],
-			smoothstep(get_stop_position(i - 1), get_stop_position(i), t));
-	}
-
-	return colour;
-}
-
 float linear_gradient(float2 origin, float2 scale, float2 p)
 {
 	return dot(scale, p - origin) / dot(scale, scale);
@@ -71,20 +44,20 @@ float4 main
 	PS_INPUT inPs
 ) : SV_Target
 {
-	float t = 0.0;
-	if(gradientType == LINEAR_GRADIENT)
-		t = linear_gradient(origin, scale, inPs.uv0);
-	else if(gradientType == RADIAL_GRADIENT)
-		t = radial_gradient(origin, scale, inPs.uv0);
-	else if(gradientType == CONIC_GRADIENT)
-		t = conic_gradient(origin, scale, inPs.uv0);
-
-	if(repeating != 0)
-	{
-		float t0 = get_stop_position(0);
-		float t1 = get_stop_position(numStops - 1);
-		t = t0 + mod(t - t0, t1 - t0);
-	}
-
-	return inPs.diffuse * mix_stop_colours(t);
+#if defined(LINEAR_GRADIENT)
+	float t = linear_gradient(gradient.xy, gradient.zw, inPs.uv0);
+#elif defined(RADIAL_GRADIENT)
+	float t = radial_gradient(gradient.xy, gradient.zw, inPs.uv0);
+#elif defined(CONIC_GRADIENT)
+	float t = conic_gradient(gradient.xy, gradient.zw, inPs.uv0);
+#endif
+
+	t = (t - lut.x) * lut.y;
+#ifdef REPEATING
+	t = frac(t);
+#endif
+
+	// Positions outside the stops are clamped by the sampler
+	float u = (t * (LUT_WIDTH - 1.0) + 0.5) / LUT_WIDTH;
+	return inPs.diffuse * lutTex.Sample( lutSampler, float2( u, lut.z ) );
 }
@@ -1,10 +1,21 @@
+// RED_MASK is defined by the Rml/MaskRed_ps program definitions in Mask.material,
+// for single channel mask images which keep their alpha in the red channel
+
 Texture2D    dstTex : register(t0);
 Texture2D    srcTex : register(t1);
 SamplerState mySampler : register(s0);
+SamplerState maskSampler : register(s1);
+
+// Fraction of dstTex used, from its top left
+uniform float2 maskScale;
 
 float4 main( float2 uv : TEXCOORD0 ) : SV_Target
 {
-	float4 dst = dstTex.Sample( mySampler, uv );
-	float4 src = srcTex.Sample( mySampler, uv );
+	float4 dst = dstTex.Sample( mySampler, uv * maskScale );
+	float4 src = srcTex.Sample( maskSampler, uv );
+#if RED_MASK
+	return dst * src.r;
+#else
 	return dst * src.a;
+#endif
 }
@@ -14,12 +14,15 @@ PS_INPUT main
 (
 	VS_INPUT input,
 	uniform matrix worldViewProj,
-	uniform float4 scissorRegion
+	uniform float4 scissorRegion,
+	// Fraction of the target drawn to, from its top left
+	uniform float2 targetSize
 )
 {
 	PS_INPUT outVs;
 
-	outVs.gl_Position = mul( worldViewProj, input.vertex );
+	float2 position = ( input.vertex.xy - float2( -1.0, 1.0 ) ) * targetSize + float2( -1.0, 1.0 );
+	outVs.gl_Position = mul( worldViewProj, float4( position, input.vertex.zw ) );
 	outVs.uv0         = scissorRegion.xy + input.uv0 * scissorRegion.zw;
 
 	return outVs;
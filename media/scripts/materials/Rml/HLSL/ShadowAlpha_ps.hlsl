@@ -0,0 +1,29 @@
+Texture2D    srcTex : register(t0);
+SamplerState mySampler : register(s0);
+
+uniform float4 viewportSize;
+// Bilinear taps along each axis, each tap averages 2x2 texels
+uniform float taps;
+
+struct PS_INPUT
+{
+	float2 uv0 : TEXCOORD0;
+};
+
+float4 main
+(
+	PS_INPUT inPs
+) : SV_Target
+{
+	int n = int( taps );
+	float2 start = inPs.uv0 - viewportSize.zw * (taps - 1.0);
+
+	float a = 0.0;
+	for( int y = 0; y < n; ++y )
+	{
+		for( int x = 0; x < n; ++x )
+			a += srcTex.Sample( mySampler, start + float2( x, y ) * 2.0 * viewportSize.zw ).a;
+	}
+
+	return a / (taps * taps);
+}
@@ -0,0 +1,26 @@
+Texture2D    srcTex : register(t0);
+Texture2D    shadowTex : register(t1);
+SamplerState srcSampler : register(s0);
+SamplerState shadowSampler : register(s1);
+
+uniform float4 viewportSize;
+uniform float4 colour;
+uniform float2 offset;
+// Resolution of the shadow relative to the source
+uniform float scale;
+
+struct PS_INPUT
+{
+	float2 uv0 : TEXCOORD0;
+};
+
+float4 main
+(
+	PS_INPUT inPs
+) : SV_Target
+{
+	float4 primary = srcTex.Sample( srcSampler, inPs.uv0 );
+	float2 shadowUv = (inPs.uv0 - offset * viewportSize.zw) * scale;
+	float shadowA = shadowTex.Sample( shadowSampler, shadowUv ).r;
+	return primary + colour * shadowA * (1 - primary.a);
+}
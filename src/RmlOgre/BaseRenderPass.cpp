@@ -44,7 +44,19 @@ void BaseRenderPass::writeRenderPass(
 		object->setPreparedMaterial(queueObject.material);
 
 		auto* sceneNode = workspace.addSceneNode();
-		sceneNode->setPosition(Ogre::Vector3{queueObject.translation.x, queueObject.translation.y, 0.0f});
+		Ogre::Vector3 translation{queueObject.translation.x, queueObject.translation.y, 0.0f};
+		if(queueObject.transform == Ogre::Matrix4::IDENTITY)
+			sceneNode->setPosition(translation);
+		else
+		{
+			Ogre::Vector3 position;
+			Ogre::Vector3 scale;
+			Ogre::Quaternion orientation;
+			(queueObject.transform * Ogre::Matrix4::getTrans(translation)).decomposition(position, scale, orientation);
+			sceneNode->setPosition(position);
+			sceneNode->setScale(scale);
+			sceneNode->setOrientation(orientation);
+		}
 		sceneNode->attachObject(object);
 
 		for(auto renderable : object->mRenderables)
@@ -58,10 +70,10 @@ void BaseRenderPass::writeRenderPass(
 		}
 	}
 
+	float width = workspace.width();
+	float height = workspace.height();
 	if(this->settings.enableScissor)
 	{
-		float width = workspace.width();
-		float height = workspace.height();
 		nodePass->scissorRegion = Ogre::Vector4{
 			this->settings.scissorRegion.Left() / width,
 			this->settings.scissorRegion.Top() / height,
@@ -73,6 +85,11 @@ void BaseRenderPass::writeRenderPass(
 		nodePass->scissorRegion = Ogre::Vector4{0.0f, 0.0f, 1.0f, 1.0f};
 	nodePass->projectionMatrix = workspace.projectionMatrix() * this->settings.transform;
 	nodePass->stencilRefValue = this->settings.stencilRefValue;
+	nodePass->enableRoundedClip = this->settings.enableRoundedClip;
+	nodePass->roundedClipRect = this->settings.roundedClipRect;
+	nodePass->roundedClipRadii = this->settings.roundedClipRadii;
+	// Inverse of the workspace's projection matrix
+	nodePass->ndcToScreen = Ogre::Vector4{0.5f * width, -0.5f * height, 0.5f * width, 0.5f * height};
 
 	nodePass->addTextureDependencies(this->textureDependencies);
 }
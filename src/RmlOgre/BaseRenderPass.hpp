@@ -9,6 +9,8 @@
 
 #include <Compositor/OgreCompositorChannel.h>
 
+#include <optional>
+
 
 namespace Ogre {
 
@@ -29,6 +31,12 @@ struct QueuedGeometry
 	Ogre::VertexArrayObject* vao = nullptr;
 	Rml::Vector2f translation;
 	Material material;
+	// Screen space bounds, before scissoring
+	Rml::Rectanglef bounds;
+	// Applied to the draw's scene node, before the pass transform
+	Ogre::Matrix4 transform = Ogre::Matrix4::IDENTITY;
+	// Compiled shader the material is from, materials are shared between shaders
+	std::optional<Rml::CompiledShaderHandle> shader;
 };
 
 struct RenderPassSettings
@@ -38,14 +46,27 @@ struct RenderPassSettings
 	Ogre::Matrix4 transform = Ogre::Matrix4::IDENTITY;
 	bool enableStencil = false;
 	Ogre::uint32 stencilRefValue = 0;
-
+	// Rounded rectangle clipped to in the pixel shader of Hlms materials, in screen
+	// pixels: centre and half size, then top left, top right, bottom right and
+	// bottom left radii
+	bool enableRoundedClip = false;
+	Ogre::Vector4 roundedClipRect = Ogre::Vector4::ZERO;
+	Ogre::Vector4 roundedClipRadii = Ogre::Vector4::ZERO;
+
+	bool equalsIgnoringScissor(const RenderPassSettings& b) const
+	{
+		return this->transform == b.transform
+			&& this->enableStencil == b.enableStencil
+			&& this->stencilRefValue == b.stencilRefValue
+			&& this->enableRoundedClip == b.enableRoundedClip
+			&& this->roundedClipRect == b.roundedClipRect
+			&& this->roundedClipRadii == b.roundedClipRadii;
+	}
 	bool operator==(const RenderPassSettings& b) const
 	{
 		return this->enableScissor == b.enableScissor
 			&& this->scissorRegion == b.scissorRegion
-			&& this->transform == b.transform
-			&& this->enableStencil == b.enableStencil
-			&& this->stencilRefValue == b.stencilRefValue;
+			&& this->equalsIgnoringScissor(b);
 	}
 	bool operator!=(const RenderPassSettings& b) const
 	{
@@ -56,6 +77,9 @@ struct RenderPassSettings
 struct BaseRenderPass : BasePass
 {
 	RenderPassSettings settings;
+	// Every draw lies inside the scissor region it was drawn with, so the
+	// pass can be scissored to their union instead
+	bool drawsInsideScissor = false;
 	std::vector<QueuedGeometry> queue;
 	Ogre::CompositorChannelVec textureDependencies;
 
@@ -5,6 +5,7 @@
 
 #include <Compositor/OgreCompositorChannel.h>
 #include <OgreMatrix4.h>
+#include <OgreVector4.h>
 #include <OgrePrerequisites.h>
 
 #include <memory>
@@ -22,6 +23,12 @@ protected:
 
 public:
 	Ogre::Matrix4 projectionMatrix = Ogre::Matrix4::IDENTITY;
+	// Clipped to in the pixel shader, see RenderPassSettings
+	bool enableRoundedClip = false;
+	Ogre::Vector4 roundedClipRect = Ogre::Vector4::ZERO;
+	Ogre::Vector4 roundedClipRadii = Ogre::Vector4::ZERO;
+	// Scale and offset from normalised device coordinates to screen pixels
+	Ogre::Vector4 ndcToScreen = Ogre::Vector4(1.0f, 1.0f, 0.0f, 0.0f);
 
 	std::unique_ptr<Ogre::RenderQueue> renderQueue;
 
@@ -17,3 +17,19 @@ void CompositorPassRenderQuadDef::addQuadTextureSource( size_t texUnitIdx, const
 	}
 	mTextureSources.push_back( QuadTextureSource( texUnitIdx, textureName ) );
 }
+
+void CompositorPassRenderQuadDef::setQuadTextureSource( size_t texUnitIdx, const Ogre::String &textureName )
+{
+	for( auto itor = mTextureSources.begin(); itor != mTextureSources.end(); ++itor )
+	{
+		if( itor->texUnitIdx == texUnitIdx )
+		{
+			// Node definitions are shared by workspaces, so this may already be set
+			if( itor->textureName == textureName )
+				return;
+			mTextureSources.erase( itor );
+			break;
+		}
+	}
+	this->addQuadTextureSource( texUnitIdx, textureName );
+}
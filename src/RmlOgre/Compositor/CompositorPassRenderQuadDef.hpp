@@ -71,6 +71,8 @@ public:
 		See CompositorPassQuadDef::QuadTextureSource for params
 	*/
 	void addQuadTextureSource( size_t texUnitIdx, const Ogre::String &textureName );
+	/// Replaces the texture source of a texture unit, or adds it
+	void setQuadTextureSource( size_t texUnitIdx, const Ogre::String &textureName );
 
 	const TextureSources &getTextureSources() const { return mTextureSources; }
 };
@@ -0,0 +1,126 @@
+#include "FilterCache.hpp"
+
+#include <algorithm>
+
+
+using namespace nimble::RmlOgre;
+
+void FilterCache::evict(std::unordered_map<std::string, Entry>::iterator entry)
+{
+	this->stats.bytes -= entry->second.bytes;
+	++this->stats.evictions;
+	this->evicted.push_back(std::move(entry->second));
+	this->entries.erase(entry);
+	this->stats.entries = this->entries.size();
+}
+
+void FilterCache::beginFrame()
+{
+	std::size_t lookups = this->frameHits + this->frameMisses;
+	this->stats.hitRate = lookups > 0 ? float(this->frameHits) / lookups : 0.0f;
+	this->frameHits = 0;
+	this->frameMisses = 0;
+
+	++this->frame;
+	for(auto entry = this->entries.begin(); entry != this->entries.end();)
+	{
+		if(this->frame - entry->second.lastUsedFrame > MAX_UNUSED_FRAMES)
+			this->evict(entry++);
+		else
+			++entry;
+	}
+
+	std::swap(this->missed, this->lastMissed);
+	this->missed.clear();
+}
+
+FilterCache::Entry* FilterCache::find(const std::string& key)
+{
+	auto entry = this->entries.find(key);
+	if(entry == this->entries.end())
+	{
+		++this->stats.misses;
+		++this->frameMisses;
+		this->missed.insert(key);
+		return nullptr;
+	}
+
+	++this->stats.hits;
+	++this->frameHits;
+	entry->second.lastUsedFrame = this->frame;
+	return &entry->second;
+}
+
+bool FilterCache::shouldStore(const std::string& key, std::size_t bytes)
+{
+	if(bytes > this->budget || this->lastMissed.count(key) == 0)
+		return false;
+
+	while(this->stats.bytes + bytes > this->budget)
+	{
+		// Least recently used, entries used this frame may still be composited
+		auto oldest = std::min_element(this->entries.begin(), this->entries.end(),
+			[](const auto& a, const auto& b) {
+				return a.second.lastUsedFrame < b.second.lastUsedFrame;
+			});
+		if(oldest == this->entries.end() || oldest->second.lastUsedFrame == this->frame)
+			return false;
+		this->evict(oldest);
+	}
+	return true;
+}
+
+FilterCache::Entry& FilterCache::store(std::string key, Entry entry)
+{
+	entry.lastUsedFrame = this->frame;
+	this->stats.bytes += entry.bytes;
+	++this->stats.stores;
+	this->missed.erase(key);
+
+	Entry& stored = this->entries.insert_or_assign(std::move(key), std::move(entry)).first->second;
+	this->stats.entries = this->entries.size();
+	return stored;
+}
+
+void FilterCache::invalidate(const void* resource)
+{
+	for(auto entry = this->entries.begin(); entry != this->entries.end();)
+	{
+		auto& resources = entry->second.resources;
+		if(std::find(resources.begin(), resources.end(), resource) != resources.end())
+			this->evict(entry++);
+		else
+			++entry;
+	}
+}
+
+void FilterCache::invalidate(Rml::CompiledFilterHandle filter)
+{
+	for(auto entry = this->entries.begin(); entry != this->entries.end();)
+	{
+		auto& filters = entry->second.filters;
+		if(std::find(filters.begin(), filters.end(), filter) != filters.end())
+			this->evict(entry++);
+		else
+			++entry;
+	}
+}
+
+void FilterCache::invalidateShader(Rml::CompiledShaderHandle shader)
+{
+	for(auto entry = this->entries.begin(); entry != this->entries.end();)
+	{
+		auto& shaders = entry->second.shaders;
+		if(std::find(shaders.begin(), shaders.end(), shader) != shaders.end())
+			this->evict(entry++);
+		else
+			++entry;
+	}
+}
+
+std::vector<FilterCache::Entry> FilterCache::takeEvicted()
+{
+	std::vector<Entry> evicted;
+	std::swap(evicted, this->evicted);
+	return evicted;
+}
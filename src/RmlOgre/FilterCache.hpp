@@ -0,0 +1,100 @@
+#ifndef NIMBLE_RMLOGRE_FILTERCACHE_HPP
+#define NIMBLE_RMLOGRE_FILTERCACHE_HPP
+
+#include <OgreMaterial.h>
+
+#include <RmlUi/Core/RenderInterface.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+namespace Ogre {
+
+class TextureGpu;
+
+}
+
+namespace nimble::RmlOgre {
+
+// Keeps the filtered output of layers between frames, so layers with the same
+// content, filters and scissor region can be composited without filtering again
+class FilterCache
+{
+public:
+	struct Entry
+	{
+		Ogre::TextureGpu* texture = nullptr;
+		std::size_t bytes = 0;
+		// Geometry, datablocks and materials the layer was rendered with
+		std::vector<const void*> resources;
+		std::vector<Rml::CompiledFilterHandle> filters;
+		std::vector<Rml::CompiledShaderHandle> shaders;
+		// Composite materials, blending and not blending
+		std::array<Ogre::MaterialPtr, 2> materials;
+		std::uint64_t lastUsedFrame = 0;
+	};
+
+	struct Stats
+	{
+		std::size_t entries = 0;
+		std::size_t bytes = 0;
+		std::size_t hits = 0;
+		std::size_t misses = 0;
+		std::size_t stores = 0;
+		std::size_t evictions = 0;
+		// Of the last frame
+		float hitRate = 0.0f;
+	};
+
+	static constexpr std::size_t DEFAULT_BUDGET = 32 * 1024 * 1024;
+	// Entries unused for longer are evicted
+	static constexpr std::uint64_t MAX_UNUSED_FRAMES = 60;
+
+private:
+	std::unordered_map<std::string, Entry> entries;
+	// Layers are only stored after missing in consecutive frames,
+	// so changing content doesn't cost an extra copy every frame
+	std::unordered_set<std::string> missed;
+	std::unordered_set<std::string> lastMissed;
+	std::vector<Entry> evicted;
+	std::size_t budget = DEFAULT_BUDGET;
+
+	std::uint64_t frame = 0;
+	Stats stats;
+	std::size_t frameHits = 0;
+	std::size_t frameMisses = 0;
+
+	void evict(std::unordered_map<std::string, Entry>::iterator entry);
+
+public:
+	void beginFrame();
+
+	// Null and counted as a miss if not cached
+	Entry* find(const std::string& key);
+	// Whether output missed last frame too and fits in the budget,
+	// evicting entries unused this frame if needed
+	bool shouldStore(const std::string& key, std::size_t bytes);
+	Entry& store(std::string key, Entry entry);
+
+	// Evict entries using a resource or filter that's being released
+	void invalidate(const void* resource);
+	void invalidate(Rml::CompiledFilterHandle filter);
+	void invalidateShader(Rml::CompiledShaderHandle shader);
+	// Evicted entries, their textures and materials must be released by the caller
+	std::vector<Entry> takeEvicted();
+
+	std::size_t getBudget() const { return this->budget; }
+	// Budget for the base level of cached textures, in bytes
+	void setBudget(std::size_t budget) { this->budget = budget; }
+
+	const Stats& getStats() const { return this->stats; }
+};
+
+}
+
+#endif // NIMBLE_RMLOGRE_FILTERCACHE_HPP
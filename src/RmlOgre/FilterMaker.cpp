@@ -22,4 +22,32 @@ void SingleMaterialFilter::release(RenderInterface& renderInterface)
 		auto* texture = textureUnit->_getTexturePtr();
 		renderInterface.releaseRenderTexture(texture);
 	}
+
+	renderInterface.getMaterialCache().release(this->material);
+	if(this->blendMaterial)
+		renderInterface.getMaterialCache().release(this->blendMaterial);
+}
+
+Ogre::MaterialPtr SingleMaterialFilter::getCompositeMaterial(RenderInterface& renderInterface, bool noBlending)
+{
+	if(noBlending)
+		return this->material;
+
+	if(!this->blendMaterial)
+		this->blendMaterial = renderInterface.getMaterialCache().acquireBlended(this->material);
+	// Not from the cache, make a blending copy for this filter only
+	if(!this->blendMaterial)
+	{
+		this->blendMaterial = Ogre::MaterialPtr(OGRE_NEW Ogre::Material(nullptr, "", 0, "", false, nullptr));
+		*this->blendMaterial = *this->material;
+		this->blendMaterial->load();
+		auto* pass = this->blendMaterial
+			->getBestTechnique()
+			->getPass(0);
+		Ogre::HlmsBlendblock blendblock = *pass->getBlendblock();
+		blendblock.mSourceBlendFactor = Ogre::SBF_ONE;
+		blendblock.mDestBlendFactor = Ogre::SBF_ONE_MINUS_SOURCE_ALPHA;
+		pass->setBlendblock(blendblock);
+	}
+	return this->blendMaterial;
 }
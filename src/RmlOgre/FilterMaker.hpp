@@ -1,6 +1,8 @@
 #ifndef NIMBLE_RMLOGRE_FILTERMAKER_HPP
 #define NIMBLE_RMLOGRE_FILTERMAKER_HPP
 
+#include "MaterialCache.hpp"
+
 #include <OgreMaterial.h>
 
 #include <RmlUi/Core/Dictionary.h>
@@ -18,11 +20,14 @@ public:
 	virtual ~Filter() {}
 	virtual void apply(RenderInterface& renderInterface) = 0;
 	virtual void release(RenderInterface& renderInterface) {}
+	// Material that applies this filter while compositing, if it can be done in one pass
+	virtual Ogre::MaterialPtr getCompositeMaterial(RenderInterface& renderInterface, bool noBlending) { return {}; }
 };
 
 class SingleMaterialFilter : public Filter
 {
 	Ogre::MaterialPtr material;
+	Ogre::MaterialPtr blendMaterial;
 
 public:
 	SingleMaterialFilter(Ogre::MaterialPtr material) :
@@ -31,12 +36,17 @@ public:
 
 	void apply(RenderInterface& renderInterface) override;
 	void release(RenderInterface& renderInterface) override;
+	Ogre::MaterialPtr getCompositeMaterial(RenderInterface& renderInterface, bool noBlending) override;
 };
 
 class FilterMaker
 {
+protected:
+	MaterialCache* materialCache = nullptr;
+
 public:
 	virtual ~FilterMaker() {}
+	virtual void setMaterialCache(MaterialCache* materialCache) { this->materialCache = materialCache; }
 	virtual std::unique_ptr<Filter> make(const Rml::Dictionary& parameters) = 0;
 };
 
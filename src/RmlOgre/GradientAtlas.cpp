@@ -0,0 +1,108 @@
+#include "GradientAtlas.hpp"
+
+#include <OgreRoot.h>
+#include <OgreStagingTexture.h>
+#include <OgreTextureBox.h>
+#include <OgreTextureGpu.h>
+#include <OgreTextureGpuManager.h>
+
+#include <cassert>
+
+
+using namespace nimble::RmlOgre;
+
+GradientAtlas::GradientAtlas(Ogre::String name) :
+	name{std::move(name)}
+{}
+GradientAtlas::~GradientAtlas()
+{
+	if(this->pages.empty())
+		return;
+
+	Ogre::TextureGpuManager* textureManager = Ogre::Root::getSingleton()
+		.getRenderSystem()
+		->getTextureGpuManager();
+	for(auto& page : this->pages)
+		textureManager->destroyTexture(page.texture);
+}
+
+GradientAtlas::Page& GradientAtlas::addPage()
+{
+	Ogre::String id = this->name;
+	id.append("_GradientAtlas_");
+	id.append(std::to_string(this->pages.size()));
+
+	Page page;
+	page.texture = Ogre::Root::getSingleton()
+		.getRenderSystem()
+		->getTextureGpuManager()
+		->createTexture(
+			id,
+			Ogre::GpuPageOutStrategy::Discard,
+			Ogre::TextureFlags::ManualTexture,
+			Ogre::TextureTypes::Type2D);
+	page.texture->setPixelFormat(Ogre::PixelFormatGpu::PFG_RGBA8_UNORM);
+	page.texture->setResolution(LUT_WIDTH, PAGE_ROWS);
+	page.texture->setNumMipmaps(1);
+	page.texture->scheduleTransitionTo(Ogre::GpuResidency::Resident);
+
+	// Hand out top rows first
+	for(std::uint32_t row = PAGE_ROWS; row > 0; --row)
+		page.freeRows.push_back(row - 1);
+
+	this->pages.push_back(std::move(page));
+	return this->pages.back();
+}
+
+GradientAtlas::Lut GradientAtlas::add(const std::vector<Ogre::uint8>& texels)
+{
+	assert(texels.size() == LUT_WIDTH * 4);
+
+	Page* page = nullptr;
+	for(auto& existingPage : this->pages)
+		if(!existingPage.freeRows.empty())
+		{
+			page = &existingPage;
+			break;
+		}
+	if(!page)
+		page = &this->addPage();
+
+	Lut lut{page->texture, page->freeRows.back()};
+	page->freeRows.pop_back();
+
+	Ogre::TextureGpuManager* textureManager = Ogre::Root::getSingleton()
+		.getRenderSystem()
+		->getTextureGpuManager();
+	Ogre::StagingTexture* stagingTexture = textureManager->getStagingTexture(
+		LUT_WIDTH, 1u, 1u, 1u, Ogre::PixelFormatGpu::PFG_RGBA8_UNORM);
+	stagingTexture->startMapRegion();
+	Ogre::TextureBox box = stagingTexture->mapRegion(
+		LUT_WIDTH, 1u, 1u, 1u, Ogre::PixelFormatGpu::PFG_RGBA8_UNORM);
+	Ogre::TextureBox srcBox(LUT_WIDTH, 1u, 1u, 1u, 4u, LUT_WIDTH * 4u, LUT_WIDTH * 4u);
+	srcBox.data = const_cast<Ogre::uint8*>(texels.data());
+	box.copyFrom(srcBox);
+	stagingTexture->stopMapRegion();
+
+	Ogre::TextureBox dstBox = lut.texture->getEmptyBox(0);
+	dstBox.y = lut.row;
+	dstBox.height = 1u;
+	stagingTexture->upload(box, lut.texture, 0, nullptr, &dstBox);
+	textureManager->removeStagingTexture(stagingTexture);
+
+	return lut;
+}
+
+void GradientAtlas::release(const Lut& lut)
+{
+	this->releasedLuts.push_back(lut);
+}
+
+void GradientAtlas::update()
+{
+	for(auto& lut : this->releasedLuts)
+		for(auto& page : this->pages)
+			if(page.texture == lut.texture)
+				page.freeRows.push_back(lut.row);
+	this->releasedLuts.clear();
+}
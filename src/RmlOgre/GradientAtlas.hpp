@@ -0,0 +1,67 @@
+#ifndef NIMBLE_RMLOGRE_GRADIENTATLAS_HPP
+#define NIMBLE_RMLOGRE_GRADIENTATLAS_HPP
+
+#include <OgrePrerequisites.h>
+
+#include <cstdint>
+#include <vector>
+
+
+namespace Ogre {
+
+class TextureGpu;
+
+}
+
+namespace nimble::RmlOgre {
+
+// Gradient colour lookup tables, one per row of shared textures
+class GradientAtlas
+{
+public:
+	// Must be same as:
+	// LUT_WIDTH in media/scripts/material/Rml/GLSL/Gradient_ps.glsl
+	// LUT_WIDTH in media/scripts/material/Rml/HLSL/Gradient_ps.hlsl
+	static constexpr std::uint32_t LUT_WIDTH = 512;
+	static constexpr std::uint32_t PAGE_ROWS = 64;
+
+	struct Lut
+	{
+		Ogre::TextureGpu* texture = nullptr;
+		std::uint32_t row = 0;
+
+		// v texture coordinate of the row's centre
+		float v() const { return (this->row + 0.5f) / PAGE_ROWS; }
+	};
+
+private:
+	struct Page
+	{
+		Ogre::TextureGpu* texture = nullptr;
+		std::vector<std::uint32_t> freeRows;
+	};
+
+	Ogre::String name;
+	std::vector<Page> pages;
+	// Rows may still be used by queued rendering until the next frame
+	std::vector<Lut> releasedLuts;
+
+	Page& addPage();
+
+public:
+	GradientAtlas(Ogre::String name);
+	~GradientAtlas();
+	GradientAtlas(const GradientAtlas&) = delete;
+	GradientAtlas& operator=(const GradientAtlas&) = delete;
+
+	// Uploads LUT_WIDTH premultiplied RGBA8 texels to a free row
+	Lut add(const std::vector<Ogre::uint8>& texels);
+	void release(const Lut& lut);
+
+	// Free released rows, they mustn't be used by any queued rendering
+	void update();
+};
+
+}
+
+#endif // NIMBLE_RMLOGRE_GRADIENTATLAS_HPP
@@ -4,6 +4,9 @@
 #include "RenderObject.hpp"
 
 #include <OgreMaterial.h>
+#include <OgreVector4.h>
+
+#include <array>
 
 
 namespace Ogre {
@@ -21,6 +24,9 @@ struct Material
 	Ogre::TextureGpu*    textureDependency = nullptr;
 	Ogre::uint32         hash = 0;
 	Ogre::uint32         casterHash = 0;
+	// Set on the renderable for each draw, read by `custom` auto parameters of the material
+	std::array<Ogre::Vector4, 2> customParameters;
+	Ogre::uint8          numCustomParameters = 0;
 
 	bool needsHashing() const
 	{
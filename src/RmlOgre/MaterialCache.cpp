@@ -0,0 +1,180 @@
+#include "MaterialCache.hpp"
+
+#include <OgreGpuProgramParams.h>
+#include <OgreHlmsDatablock.h>
+#include <OgreTechnique.h>
+
+#include <type_traits>
+
+
+using namespace nimble::RmlOgre;
+
+namespace {
+
+void append_bytes(std::string& key, const void* data, std::size_t size)
+{
+	key.append(static_cast<const char*>(data), size);
+}
+
+std::string make_pool_key(const Ogre::MaterialPtr& base, bool blend)
+{
+	std::string key;
+	const Ogre::Material* basePointer = base.get();
+	append_bytes(key, &basePointer, sizeof(basePointer));
+	key.push_back(blend ? 1 : 0);
+	return key;
+}
+
+std::string make_key(const Ogre::MaterialPtr& base, const MaterialCache::Parameters& parameters, bool blend)
+{
+	std::string key = make_pool_key(base, blend);
+	for(auto& parameter : parameters)
+	{
+		key.push_back(static_cast<char>(parameter.program));
+		key.append(parameter.name);
+		key.push_back('\0');
+		key.push_back(static_cast<char>(parameter.value.index()));
+		std::visit([&key](const auto& value) {
+			using T = std::decay_t<decltype(value)>;
+			if constexpr(std::is_same_v<T, std::vector<float>>)
+			{
+				std::size_t size = value.size();
+				append_bytes(key, &size, sizeof(size));
+				append_bytes(key, value.data(), value.size() * sizeof(float));
+			}
+			else if constexpr(std::is_same_v<T, Ogre::Matrix4>)
+				append_bytes(key, value[0], 16 * sizeof(Ogre::Real));
+			else if constexpr(std::is_same_v<T, Ogre::Vector2> || std::is_same_v<T, Ogre::Vector4>)
+				append_bytes(key, value.ptr(), sizeof(value));
+			else
+				append_bytes(key, &value, sizeof(value));
+		}, parameter.value);
+	}
+	return key;
+}
+
+void set_parameters(const Ogre::MaterialPtr& material, const MaterialCache::Parameters& parameters)
+{
+	auto* pass = material
+		->getBestTechnique()
+		->getPass(0);
+	for(auto& parameter : parameters)
+	{
+		auto programParameters = parameter.program == Ogre::GPT_VERTEX_PROGRAM
+			? pass->getVertexProgramParameters()
+			: pass->getFragmentProgramParameters();
+		std::visit([&](const auto& value) {
+			using T = std::decay_t<decltype(value)>;
+			if constexpr(std::is_same_v<T, Ogre::TextureGpu*>)
+				pass->getTextureUnitState(parameter.name)->setTexture(value);
+			else if constexpr(std::is_same_v<T, std::vector<float>>)
+				programParameters->setNamedConstant(parameter.name, value.data(), value.size() / 4);
+			else
+				programParameters->setNamedConstant(parameter.name, value);
+		}, parameter.value);
+	}
+}
+
+}
+
+Ogre::MaterialPtr MaterialCache::create(const Ogre::MaterialPtr& base, bool blend)
+{
+	Ogre::MaterialPtr material(OGRE_NEW Ogre::Material(nullptr, "", 0, "", false, nullptr));
+	*material = *base;
+	material->load();
+	if(blend)
+	{
+		auto* pass = material
+			->getBestTechnique()
+			->getPass(0);
+		Ogre::HlmsBlendblock blendblock = *pass->getBlendblock();
+		blendblock.mSourceBlendFactor = Ogre::SBF_ONE;
+		blendblock.mDestBlendFactor = Ogre::SBF_ONE_MINUS_SOURCE_ALPHA;
+		pass->setBlendblock(blendblock);
+	}
+
+	++this->stats.creations;
+	++this->periodCreations;
+	return material;
+}
+
+Ogre::MaterialPtr MaterialCache::acquire(const Ogre::MaterialPtr& base, Parameters parameters, bool blend)
+{
+	std::string key = make_key(base, parameters, blend);
+	auto entry = this->entries.find(key);
+	if(entry == this->entries.end())
+	{
+		Ogre::MaterialPtr material;
+		auto& pool = this->pools[make_pool_key(base, blend)];
+		if(!pool.empty())
+		{
+			material = pool.back();
+			pool.pop_back();
+		}
+		else
+			material = this->create(base, blend);
+		set_parameters(material, parameters);
+
+		this->keys.emplace(material.get(), key);
+		entry = this->entries.emplace(
+			std::move(key),
+			Entry{material, base, std::move(parameters), blend}
+		).first;
+	}
+
+	++entry->second.references;
+	return entry->second.material;
+}
+
+Ogre::MaterialPtr MaterialCache::acquireBlended(const Ogre::MaterialPtr& material)
+{
+	auto key = this->keys.find(material.get());
+	if(key == this->keys.end())
+		return {};
+
+	const Entry& entry = this->entries.at(key->second);
+	return this->acquire(entry.base, entry.parameters, true);
+}
+
+void MaterialCache::release(const Ogre::MaterialPtr& material)
+{
+	auto key = this->keys.find(material.get());
+	if(key == this->keys.end())
+		return;
+
+	Entry& entry = this->entries.at(key->second);
+	if(--entry.references == 0)
+		this->releasedKeys.push_back(key->second);
+}
+
+void MaterialCache::update()
+{
+	for(auto& key : this->releasedKeys)
+	{
+		auto entry = this->entries.find(key);
+		// Already pooled, or acquired again since being released
+		if(entry == this->entries.end() || entry->second.references > 0)
+			continue;
+
+		auto& pool = this->pools[make_pool_key(entry->second.base, entry->second.blend)];
+		if(pool.size() < MAX_POOLED)
+			pool.push_back(entry->second.material);
+		this->keys.erase(entry->second.material.get());
+		this->entries.erase(entry);
+	}
+	this->releasedKeys.clear();
+
+	this->stats.materials = this->entries.size();
+	this->stats.pooledMaterials = 0;
+	for(auto& pool : this->pools)
+		this->stats.pooledMaterials += pool.second.size();
+
+	auto now = std::chrono::steady_clock::now();
+	std::chrono::duration<float> period = now - this->periodStart;
+	if(period.count() >= 1.0f)
+	{
+		this->stats.creationsPerSecond = this->periodCreations / period.count();
+		this->periodCreations = 0;
+		this->periodStart = now;
+	}
+}
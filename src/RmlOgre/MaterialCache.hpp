@@ -0,0 +1,96 @@
+#ifndef NIMBLE_RMLOGRE_MATERIALCACHE_HPP
+#define NIMBLE_RMLOGRE_MATERIALCACHE_HPP
+
+#include <OgreGpuProgram.h>
+#include <OgreMaterial.h>
+#include <OgreMatrix4.h>
+#include <OgreVector2.h>
+#include <OgreVector4.h>
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+
+namespace Ogre {
+
+class TextureGpu;
+
+}
+
+namespace nimble::RmlOgre {
+
+// Shares materials with the same base material and parameters. Released
+// materials are pooled and reused by changing their parameters, instead of
+// cloning and loading a new material.
+class MaterialCache
+{
+public:
+	using Value = std::variant<
+		float,
+		Ogre::Vector2,
+		Ogre::Vector4,
+		Ogre::Matrix4,
+		std::vector<float>,
+		Ogre::TextureGpu*
+	>;
+
+	struct Parameter
+	{
+		// Ignored for textures, which are set on the texture unit with this name
+		Ogre::GpuProgramType program;
+		Ogre::String name;
+		Value value;
+	};
+	using Parameters = std::vector<Parameter>;
+
+	struct Stats
+	{
+		std::size_t materials = 0;
+		std::size_t pooledMaterials = 0;
+		std::size_t creations = 0;
+		float creationsPerSecond = 0.0f;
+	};
+
+	// Maximum released materials kept for each base material
+	static constexpr std::size_t MAX_POOLED = 16;
+
+private:
+	struct Entry
+	{
+		Ogre::MaterialPtr material;
+		Ogre::MaterialPtr base;
+		Parameters parameters;
+		bool blend = false;
+		int references = 0;
+	};
+
+	std::unordered_map<std::string, Entry> entries;
+	std::unordered_map<const Ogre::Material*, std::string> keys;
+	std::unordered_map<std::string, std::vector<Ogre::MaterialPtr>> pools;
+	std::vector<std::string> releasedKeys;
+
+	Stats stats;
+	std::size_t periodCreations = 0;
+	std::chrono::steady_clock::time_point periodStart = std::chrono::steady_clock::now();
+
+	Ogre::MaterialPtr create(const Ogre::MaterialPtr& base, bool blend);
+
+public:
+	Ogre::MaterialPtr acquire(const Ogre::MaterialPtr& base, Parameters parameters, bool blend = false);
+	// Same material but blending with premultiplied alpha, null if the material isn't cached
+	Ogre::MaterialPtr acquireBlended(const Ogre::MaterialPtr& material);
+	// Materials that aren't cached are ignored
+	void release(const Ogre::MaterialPtr& material);
+
+	// Pool released materials, they mustn't be used by any queued rendering
+	void update();
+
+	const Stats& getStats() const { return this->stats; }
+};
+
+}
+
+#endif // NIMBLE_RMLOGRE_MATERIALCACHE_HPP
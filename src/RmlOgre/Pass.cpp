@@ -45,15 +45,18 @@ CompositePass::CompositePass(
 	int dstIn,
 	int tmpOut,
 	bool noBlending,
-	const RenderPassSettings& renderPassSettings
+	const RenderPassSettings& renderPassSettings,
+	Ogre::MaterialPtr material
 ) :
-	RenderQuadPass(nullptr, renderPassSettings),
+	RenderQuadPass(material, renderPassSettings),
 
 	dstIn{dstIn},
 	tmpOut{tmpOut}
 {
-	if(noBlending)
-		this->material = Ogre::MaterialManager::getSingleton().getByName("Ogre/Copy/4xFP32");
+	// Always set the material, node instances are reused by other composites
+	if(!this->material)
+		this->material = Ogre::MaterialManager::getSingleton().getByName(
+			noBlending ? "Ogre/Copy/4xFP32" : "Rml/AlphaBlend");
 }
 
 void RenderToTexturePass::writePass(
@@ -83,7 +86,8 @@ void RenderToTexturePass::writePass(
 	else
 		scissorRegion = Ogre::Vector4{0.0f, 0.0f, 1.0f, 1.0f};
 
-	auto baseMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/ScissorCopy");
+	auto baseMaterial = Ogre::MaterialManager::getSingleton().getByName(
+		this->alphaOnly ? "Rml/ScissorCopyAlpha" : "Rml/ScissorCopy");
 	Ogre::MaterialPtr material(OGRE_NEW Ogre::Material(nullptr, "", 0, "", false, nullptr));
 	*material = *baseMaterial;
 	material->load();
@@ -91,5 +95,6 @@ void RenderToTexturePass::writePass(
 	auto* pass = technique->getPass(0);
 	auto vertexProgramParameters = pass->getVertexProgramParameters();
 	vertexProgramParameters->setNamedConstant("scissorRegion", scissorRegion);
+	vertexProgramParameters->setNamedConstant("targetSize", this->targetSize);
 	nodePass->setMaterial(material);
 }
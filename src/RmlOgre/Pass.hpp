@@ -5,9 +5,11 @@
 #include "RenderObject.hpp"
 
 #include <OgreHlmsDatablock.h>
+#include <OgreVector2.h>
 
 #include <RmlUi/Core/RenderInterface.h>
 
+#include <array>
 #include <variant>
 
 
@@ -217,7 +219,8 @@ struct CompositePass : RenderQuadPass
 		int dstIn,
 		int tmpOut,
 		bool noBlending,
-		const RenderPassSettings& renderPassSettings);
+		const RenderPassSettings& renderPassSettings,
+		Ogre::MaterialPtr material = {});
 
 	void addExtraConnections(NodeConnectionMap& connections) const override
 	{
@@ -253,14 +256,22 @@ struct RenderToTexturePass : RenderQuadPass
 	static constexpr const char* BASE_NODE_NAME = "Rml/RenderToTexture";
 
 	int renderTexture = -1;
+	// Fraction of the render texture copied to, from its top left
+	Ogre::Vector2 targetSize = Ogre::Vector2::UNIT_SCALE;
+	// Copy alpha alone, for single channel mask images
+	bool alphaOnly = false;
 
 	RenderToTexturePass(
 		int renderTexture,
-		const RenderPassSettings& renderPassSettings
+		Ogre::Vector2 targetSize,
+		const RenderPassSettings& renderPassSettings,
+		bool alphaOnly = false
 	) :
 		RenderQuadPass(nullptr, renderPassSettings),
 
-		renderTexture{renderTexture}
+		renderTexture{renderTexture},
+		targetSize{targetSize},
+		alphaOnly{alphaOnly}
 	{}
 
 	void addExtraConnections(NodeConnectionMap& connections) const override
@@ -275,6 +286,28 @@ struct RenderToTexturePass : RenderQuadPass
 	) const;
 };
 
+// Drop shadow blurred from alpha alone, in the single channel targets of Rml/DropShadow
+struct DropShadowPass : BasePass
+{
+	static constexpr const char* BASE_NODE_NAME = "Rml/DropShadow";
+
+	// Extract alpha, blur horizontally, blur vertically, then composite
+	std::array<RenderQuadPass, 4> quadPasses;
+
+	DropShadowPass(std::array<RenderQuadPass, 4> quadPasses) :
+		quadPasses{std::move(quadPasses)}
+	{}
+
+	void writePass(
+		Workspace& workspace,
+		Ogre::CompositorNode* node
+	) const override
+	{
+		for(std::size_t i = 0; i < this->quadPasses.size(); ++i)
+			this->quadPasses[i].writePass(workspace, node, i);
+	}
+};
+
 using Pass = std::variant<
 	NullPass,
 	RenderPass,
@@ -290,7 +323,8 @@ using Pass = std::variant<
 	CompositeWithStencilPass,
 	RenderQuadPass,
 	ClearSecondaryPass,
-	RenderToTexturePass
+	RenderToTexturePass,
+	DropShadowPass
 >;
 
 }
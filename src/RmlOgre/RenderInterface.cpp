@@ -12,10 +12,16 @@
 #include <Hlms/Unlit/OgreHlmsUnlit.h>
 #include <Hlms/Unlit/OgreHlmsUnlitDatablock.h>
 #include <OgreCamera.h>
+#include <OgreException.h>
 #include <OgreHlmsManager.h>
+#include <OgreImage2.h>
+#include <OgreMaterialManager.h>
 #include <OgrePixelFormatGpuUtils.h>
 #include <OgreRenderQueue.h>
+#include <OgreResourceGroupManager.h>
 #include <OgreRoot.h>
+#include <OgreStagingTexture.h>
+#include <OgreTextureBox.h>
 #include <OgreTextureFilters.h>
 #include <OgreTextureGpuManager.h>
 #include <Vao/OgreVaoManager.h>
@@ -24,9 +30,126 @@
 #include <RmlUi/Core/Core.h>
 #include <RmlUi/Core/Context.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <utility>
+
 
 using namespace nimble::RmlOgre;
 
+namespace {
+
+bool overlaps(const Rml::Rectanglef& a, const Rml::Rectanglef& b)
+{
+	return a.p0.x < b.p1.x && a.p1.x > b.p0.x
+		&& a.p0.y < b.p1.y && a.p1.y > b.p0.y;
+}
+
+bool contains(const Rml::Rectanglef& outer, const Rml::Rectanglef& inner)
+{
+	return inner.p0.x >= outer.p0.x && inner.p1.x <= outer.p1.x
+		&& inner.p0.y >= outer.p0.y && inner.p1.y <= outer.p1.y;
+}
+
+// Whether the scissor region of settings clips part of bounds
+bool scissorClips(const RenderPassSettings& settings, const Rml::Rectanglef& bounds)
+{
+	return settings.enableScissor && !contains(
+		Rml::Rectanglef::FromCorners(
+			Rml::Vector2f(settings.scissorRegion.p0),
+			Rml::Vector2f(settings.scissorRegion.p1)),
+		bounds);
+}
+
+Rml::Rectanglef intersection(const Rml::Rectanglef& a, const Rml::Rectanglef& b)
+{
+	return Rml::Rectanglef::FromCorners(
+		Rml::Vector2f{std::max(a.p0.x, b.p0.x), std::max(a.p0.y, b.p0.y)},
+		Rml::Vector2f{std::min(a.p1.x, b.p1.x), std::min(a.p1.y, b.p1.y)});
+}
+
+// Empty instead of invalid when a and b don't overlap
+Rml::Rectanglei intersection(const Rml::Rectanglei& a, const Rml::Rectanglei& b)
+{
+	Rml::Vector2i p0{std::max(a.p0.x, b.p0.x), std::max(a.p0.y, b.p0.y)};
+	Rml::Vector2i p1{std::min(a.p1.x, b.p1.x), std::min(a.p1.y, b.p1.y)};
+	return Rml::Rectanglei::FromCorners(p0, Rml::Vector2i{std::max(p0.x, p1.x), std::max(p0.y, p1.y)});
+}
+
+void append_bytes(std::string& key, const void* data, std::size_t size)
+{
+	key.append(static_cast<const char*>(data), size);
+}
+
+// Source holds region's premultiplied RGBA8 texels, row by row
+void upload_texture_region(
+	Ogre::TextureGpu* texture,
+	Rml::Span<const Rml::byte> source,
+	Rml::Rectanglei region)
+{
+	if(region.Width() <= 0 || region.Height() <= 0)
+		return;
+
+	Ogre::uint32 width = region.Width();
+	Ogre::uint32 height = region.Height();
+	Ogre::TextureGpuManager* textureManager = Ogre::Root::getSingleton()
+		.getRenderSystem()
+		->getTextureGpuManager();
+	Ogre::StagingTexture* stagingTexture = textureManager->getStagingTexture(
+		width, height, 1u, 1u, texture->getPixelFormat());
+	stagingTexture->startMapRegion();
+	Ogre::TextureBox box = stagingTexture->mapRegion(
+		width, height, 1u, 1u, texture->getPixelFormat());
+	Ogre::TextureBox sourceBox(width, height, 1u, 1u, 4u, width * 4u, width * height * 4u);
+	sourceBox.data = const_cast<Rml::byte*>(source.data());
+	box.copyFrom(sourceBox);
+	stagingTexture->stopMapRegion();
+
+	Ogre::TextureBox destinationBox = texture->getEmptyBox(0);
+	destinationBox.x = region.Left();
+	destinationBox.y = region.Top();
+	destinationBox.width = width;
+	destinationBox.height = height;
+	stagingTexture->upload(box, texture, 0, nullptr, &destinationBox);
+	textureManager->removeStagingTexture(stagingTexture);
+}
+
+// Whether a scene node's position, scale and orientation can represent the transform
+bool is_node_transform(const Ogre::Matrix4& transform)
+{
+	if(!transform.isAffine())
+		return false;
+
+	Ogre::Vector3 position;
+	Ogre::Vector3 scale;
+	Ogre::Quaternion orientation;
+	transform.decomposition(position, scale, orientation);
+	Ogre::Matrix4 node;
+	node.makeTransform(position, scale, orientation);
+
+	// Skewed and mirrored transforms aren't rebuilt
+	constexpr float EPSILON = 1e-4f;
+	for(int i = 0; i < 3; ++i)
+		for(int j = 0; j < 4; ++j)
+			if(!(std::abs(node[i][j] - transform[i][j]) <= EPSILON * (1.0f + std::abs(transform[i][j]))))
+				return false;
+	return true;
+}
+
+// Fraction of a pooled render texture taken by a size, from its top left
+Ogre::Vector2 used_fraction(Rml::Vector2i size, const Ogre::TextureGpu* texture)
+{
+	return Ogre::Vector2{
+		float(std::max(size.x, 1)) / texture->getWidth(),
+		float(std::max(size.y, 1)) / texture->getHeight()
+	};
+}
+
+}
+
 RenderInterface::RenderInterface(
 	const Ogre::String& name,
 	Ogre::SceneManager* sceneManager,
@@ -34,6 +157,9 @@ RenderInterface::RenderInterface(
 	Ogre::TextureGpu* background
 ) :
 	hlms{static_cast<Ogre::HlmsUnlit*>(Ogre::Root::getSingleton().getHlmsManager()->getHlms(Ogre::HLMS_UNLIT))},
+	roundedClipListener(RoundedClipListener::acquire(this->hlms)),
+	gradientAtlas(name),
+	textureAtlas(name),
 	workspace(name, sceneManager, output, background)
 {
 	this->macroblock.mScissorTestEnabled = true;
@@ -48,10 +174,15 @@ RenderInterface::RenderInterface(
 
 	this->samplerblock.mU = Ogre::TextureAddressingMode::TAM_WRAP;
 	this->samplerblock.mV = Ogre::TextureAddressingMode::TAM_WRAP;
+	// Trilinear for minified textures with mipmaps, the same as bilinear without
+	this->samplerblock.mMipFilter = Ogre::FO_LINEAR;
+
+	this->geometries.insert({});
 
 	auto* noTextureDatablock = static_cast<Ogre::HlmsUnlitDatablock*>(
 		this->hlms->getDatablock("NoTexture"));
 	if(!noTextureDatablock)
+	{
 		noTextureDatablock = static_cast<Ogre::HlmsUnlitDatablock*>(
 			this->hlms->createDatablock(
 				"NoTexture",
@@ -60,11 +191,36 @@ RenderInterface::RenderInterface(
 				this->blendblock,
 				Ogre::HlmsParamVec())
 		);
+
+		// Untextured draws sample a white texture array, so they use the
+		// same shader as textured draws and can be batched between them
+		Ogre::TextureGpu* white = Ogre::Root::getSingleton()
+			.getRenderSystem()
+			->getTextureGpuManager()
+			->createTexture(
+				"NoTexture",
+				Ogre::GpuPageOutStrategy::Discard,
+				Ogre::TextureFlags::ManualTexture | Ogre::TextureFlags::AutomaticBatching,
+				Ogre::TextureTypes::Type2D,
+				Ogre::BLANKSTRING);
+		white->setNumMipmaps(1);
+		white->setResolution(1, 1);
+		white->setPixelFormat(Ogre::PixelFormatGpu::PFG_RGBA8_UNORM);
+		white->scheduleTransitionTo(Ogre::GpuResidency::Resident);
+		static const std::array<Rml::byte, 4> WHITE{255, 255, 255, 255};
+		upload_texture_region(
+			white,
+			Rml::Span<const Rml::byte>{WHITE.data(), WHITE.size()},
+			Rml::Rectanglei::FromSize({1, 1}));
+		noTextureDatablock->setTexture(0, white, &this->samplerblock);
+	}
 	noTextureDatablock->setUseColour(true);
 	Material noTextureMaterial{nullptr, noTextureDatablock};
 	noTextureMaterial.calculateHlmsHash();
 	this->materials.insert(std::move(noTextureMaterial));
 
+	this->maskImageFilterMaker.setMaterialCache(&this->materialCache);
+	this->colourMatrixFilterMaker.setMaterialCache(&this->materialCache);
 	this->AddFilterMaker("blur", std::make_unique<BlurFilterMaker>());
 	this->AddFilterMaker("drop-shadow", std::make_unique<DropShadowFilterMaker>());
 	this->AddFilterMaker("opacity", std::make_unique<OpacityFilterMaker>());
@@ -77,10 +233,12 @@ RenderInterface::RenderInterface(
 	this->AddFilterMaker("saturate", std::make_unique<SaturateFilterMaker>());
 	this->filters.insert({});
 
-	this->AddShaderMaker("linear-gradient", std::make_unique<LinearGradientMaker>());
-	this->AddShaderMaker("radial-gradient", std::make_unique<RadialGradientMaker>());
-	this->AddShaderMaker("conic-gradient", std::make_unique<ConicGradientMaker>());
+	this->AddShaderMaker("linear-gradient", std::make_unique<LinearGradientMaker>(this->gradientAtlas));
+	this->AddShaderMaker("radial-gradient", std::make_unique<RadialGradientMaker>(this->gradientAtlas));
+	this->AddShaderMaker("conic-gradient", std::make_unique<ConicGradientMaker>(this->gradientAtlas));
 	this->shaders.insert({});
+
+	this->cachedLayerMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/CachedLayer");
 }
 
 void RenderInterface::releaseBufferedGeometries()
@@ -91,7 +249,8 @@ void RenderInterface::releaseBufferedGeometries()
 
 	for(Rml::CompiledGeometryHandle geometry : this->releaseGeometries)
 	{
-		auto* vao = reinterpret_cast<Ogre::VertexArrayObject*>(geometry);
+		auto* vao = this->geometries.at(geometry).vao;
+		this->filterCache.invalidate(vao);
 
 		for(auto* buffer : vao->getVertexBuffers())
 			vaoManager->destroyVertexBuffer(buffer);
@@ -99,10 +258,116 @@ void RenderInterface::releaseBufferedGeometries()
 		if(vao->getIndexBuffer())
 			vaoManager->destroyIndexBuffer(vao->getIndexBuffer());
 		vaoManager->destroyVertexArrayObject(vao);
+
+		this->geometries.erase(geometry);
 	}
 	this->releaseGeometries.clear();
 }
 
+void RenderInterface::updateTextureMetadata()
+{
+	auto ready = std::remove_if(
+		this->pendingTextureMetadata.begin(),
+		this->pendingTextureMetadata.end(),
+		[this](const std::pair<Rml::String, Ogre::TextureGpu*>& pending) {
+			if(!pending.second->isMetadataReady())
+				return false;
+			this->textureMetadata[pending.first] = Rml::Vector2i(
+				pending.second->getWidth(),
+				pending.second->getHeight());
+			return true;
+		});
+	this->pendingTextureMetadata.erase(ready, this->pendingTextureMetadata.end());
+}
+
+void RenderInterface::useTexture(Rml::TextureHandle texture)
+{
+	if(texture >= this->textureLastUsed.size())
+		this->textureLastUsed.resize(texture + 1, 0);
+	this->textureLastUsed[texture] = this->frame;
+
+	if(!this->evictedTextures.empty() && this->evictedTextures.erase(texture) > 0)
+	{
+		// Drawn blank until it's loaded again
+		auto* datablock = static_cast<Ogre::HlmsUnlitDatablock*>(this->materials.at(texture).datablock);
+		datablock->getTexture(0)->scheduleTransitionTo(Ogre::GpuResidency::Resident);
+		++this->textureMemoryStats.reloads;
+	}
+}
+
+void RenderInterface::evictTextures()
+{
+	std::size_t residentBytes = 0;
+	std::vector<std::pair<std::uint64_t, const LoadedTexture*>> unused;
+	for(auto& loaded : this->loadedTextures)
+	{
+		const LoadedTexture& texture = loaded.second;
+		// Packed images share their texture, so aren't paged out
+		if(!texture.texture || this->evictedTextures.count(texture.handle) > 0)
+			continue;
+
+		residentBytes += texture.texture->getSizeBytes();
+		std::uint64_t lastUsed = this->textureLastUsed.at(texture.handle);
+		if(this->frame - lastUsed >= this->textureEvictionFrames)
+			unused.emplace_back(lastUsed, &texture);
+	}
+
+	if(residentBytes > this->textureMemoryStats.budget)
+	{
+		std::sort(unused.begin(), unused.end(), [](const auto& a, const auto& b) {
+			return a.first < b.first;
+		});
+		for(auto& texture : unused)
+		{
+			if(residentBytes <= this->textureMemoryStats.budget)
+				break;
+
+			residentBytes -= texture.second->texture->getSizeBytes();
+			texture.second->texture->scheduleTransitionTo(Ogre::GpuResidency::OnStorage);
+			this->evictedTextures.insert(texture.second->handle);
+			++this->textureMemoryStats.evictions;
+		}
+	}
+	this->textureMemoryStats.residentBytes = residentBytes;
+}
+
+void RenderInterface::evictOpacityMaterials()
+{
+	for(auto opacityMaterial = this->opacityMaterials.begin(); opacityMaterial != this->opacityMaterials.end();)
+	{
+		if(this->frame - opacityMaterial->second.lastUsed >= OPACITY_MATERIAL_EVICTION_FRAMES)
+		{
+			Ogre::HlmsDatablock* datablock = opacityMaterial->second.material.datablock;
+			this->filterCache.invalidate(datablock);
+			this->hlms->destroyDatablock(datablock->getName());
+			opacityMaterial = this->opacityMaterials.erase(opacityMaterial);
+		}
+		else
+			++opacityMaterial;
+	}
+	this->releaseFilterCacheEntries();
+}
+
+void RenderInterface::destroyTextureDatablock(Ogre::HlmsDatablock* datablock)
+{
+	assert(datablock->getLinkedRenderables().empty());
+
+	for(auto opacityMaterial = this->opacityMaterials.begin(); opacityMaterial != this->opacityMaterials.end();)
+	{
+		if(opacityMaterial->first.first == datablock)
+		{
+			this->filterCache.invalidate(opacityMaterial->second.material.datablock);
+			this->hlms->destroyDatablock(opacityMaterial->second.material.datablock->getName());
+			opacityMaterial = this->opacityMaterials.erase(opacityMaterial);
+		}
+		else
+			++opacityMaterial;
+	}
+
+	this->filterCache.invalidate(datablock);
+	this->hlms->destroyDatablock(datablock->getName());
+}
+
 void RenderInterface::releaseBufferedTextures()
 {
 	Ogre::TextureGpuManager& textureManager = *Ogre::Root::getSingleton().getRenderSystem()
@@ -114,21 +379,622 @@ void RenderInterface::releaseBufferedTextures()
 		auto* datablock = static_cast<Ogre::HlmsUnlitDatablock*>(material.datablock);
 		auto* textureGpu = datablock->getTexture(0);
 
-		assert(datablock->getLinkedRenderables().empty());
-
-		this->hlms->destroyDatablock(datablock->getName());
-		if(!this->workspace.freeRenderTexture(textureGpu))
+		this->destroyTextureDatablock(datablock);
+		this->pendingTextureMetadata.erase(
+			std::remove_if(
+				this->pendingTextureMetadata.begin(),
+				this->pendingTextureMetadata.end(),
+				[textureGpu](const std::pair<Rml::String, Ogre::TextureGpu*>& pending) {
+					return pending.second == textureGpu;
+				}),
+			this->pendingTextureMetadata.end());
+		auto atlasRegion = this->atlasRegions.find(texture);
+		if(atlasRegion != this->atlasRegions.end())
+		{
+			this->textureAtlas.release(atlasRegion->second);
+			this->atlasRegions.erase(atlasRegion);
+		}
+		else if(!this->workspace.freeRenderTexture(textureGpu))
 			textureManager.destroyTexture(textureGpu);
 
 		this->materials.erase(texture);
+		this->evictedTextures.erase(texture);
+		auto source = this->loadedTextureSources.find(texture);
+		if(source != this->loadedTextureSources.end())
+		{
+			this->loadedTextures.erase(source->second);
+			this->loadedTextureSources.erase(source);
+		}
 	}
 	this->releaseTextures.clear();
 
+	for(Ogre::HlmsDatablock* datablock : this->releaseDatablocks)
+		this->destroyTextureDatablock(datablock);
+	this->releaseDatablocks.clear();
+	this->releaseFilterCacheEntries();
+
 	for(Ogre::TextureGpu* texture : this->releaseRenderTextures)
 		this->workspace.freeRenderTexture(texture);
 	this->releaseRenderTextures.clear();
 }
 
+Rml::Rectanglef RenderInterface::screenBounds(const Geometry& geometry, Rml::Vector2f translation) const
+{
+	if(!geometry.bounds.Valid())
+		return geometry.bounds;
+
+	Rml::Vector2f min = geometry.bounds.p0 + translation;
+	Rml::Vector2f max = geometry.bounds.p1 + translation;
+
+	Ogre::Matrix4 transform = this->renderPassSettings.transform * this->drawTransform;
+	if(transform != Ogre::Matrix4::IDENTITY)
+	{
+		// Don't try to bound projected geometry, it may be behind the viewer
+		if(!transform.isAffine())
+			return Rml::Rectanglef::FromCorners(
+				Rml::Vector2f{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()},
+				Rml::Vector2f{std::numeric_limits<float>::max(), std::numeric_limits<float>::max()});
+
+		std::array<Ogre::Vector3, 4> corners{
+			Ogre::Vector3{min.x, min.y, 0.0f},
+			Ogre::Vector3{max.x, min.y, 0.0f},
+			Ogre::Vector3{min.x, max.y, 0.0f},
+			Ogre::Vector3{max.x, max.y, 0.0f}
+		};
+		Ogre::Vector3 transformedMin = transform.transformAffine(corners[0]);
+		Ogre::Vector3 transformedMax = transformedMin;
+		for(auto& corner : corners)
+		{
+			Ogre::Vector3 transformed = transform.transformAffine(corner);
+			transformedMin.makeFloor(transformed);
+			transformedMax.makeCeil(transformed);
+		}
+		min = Rml::Vector2f{transformedMin.x, transformedMin.y};
+		max = Rml::Vector2f{transformedMax.x, transformedMax.y};
+	}
+
+	return Rml::Rectanglef::FromCorners(min, max);
+}
+
+Rml::Rectanglef RenderInterface::clipRegion(const RenderPassSettings& settings) const
+{
+	if(settings.enableScissor)
+		return Rml::Rectanglef::FromCorners(
+			Rml::Vector2f(settings.scissorRegion.p0),
+			Rml::Vector2f(settings.scissorRegion.p1));
+
+	return Rml::Rectanglef::FromSize(
+		Rml::Vector2f{float(this->workspace.width()), float(this->workspace.height())});
+}
+
+bool RenderInterface::isVisible(const Rml::Rectanglef& bounds) const
+{
+	return bounds.Valid() && overlaps(bounds, this->clipRegion(this->renderPassSettings));
+}
+
+bool RenderInterface::screenRectangle(
+	const Geometry& geometry,
+	Rml::Vector2f translation,
+	Rml::Rectanglei& region) const
+{
+	if(!geometry.isRectangle || this->renderPassSettings.transform != Ogre::Matrix4::IDENTITY)
+		return false;
+	// Draw transforms are affine, rotations other than by multiples of 180 degrees aren't axis aligned
+	const Ogre::Matrix4& transform = this->drawTransform;
+	if(transform[0][1] != 0.0f || transform[1][0] != 0.0f)
+		return false;
+
+	// Pixels with their centres inside, as rasterised
+	Rml::Rectanglef bounds = this->screenBounds(geometry, translation);
+	region = Rml::Rectanglei::FromCorners(
+		Rml::Vector2i{int(std::ceil(bounds.p0.x - 0.5f)), int(std::ceil(bounds.p0.y - 0.5f))},
+		Rml::Vector2i{int(std::ceil(bounds.p1.x - 0.5f)), int(std::ceil(bounds.p1.y - 0.5f))});
+	return true;
+}
+
+bool RenderInterface::screenHull(
+	const std::vector<Rml::Vector2f>& convexHull,
+	Rml::Vector2f translation,
+	std::vector<Rml::Vector2f>& hull) const
+{
+	const Ogre::Matrix4& passTransform = this->renderPassSettings.transform;
+	if(convexHull.empty() || !passTransform.isAffine())
+		return false;
+
+	Ogre::Matrix4 transform = passTransform * this->drawTransform;
+	float determinant = transform[0][0] * transform[1][1] - transform[0][1] * transform[1][0];
+	if(determinant == 0.0f)
+		return false;
+
+	hull.clear();
+	for(auto& p : convexHull)
+	{
+		Ogre::Vector3 q = transform * Ogre::Vector3{p.x + translation.x, p.y + translation.y, 0.0f};
+		hull.push_back(Rml::Vector2f{q.x, q.y});
+	}
+	// Mirrored hulls would be clockwise
+	if(determinant < 0.0f)
+		std::reverse(hull.begin(), hull.end());
+	return true;
+}
+
+bool RenderInterface::screenRoundedRectangle(
+	Geometry& geometry,
+	Rml::Vector2f translation,
+	RoundedClip& clip) const
+{
+	// Corners stay circular
+	Ogre::Matrix4 transform = this->renderPassSettings.transform * this->drawTransform;
+	float scale = transform[0][0];
+	if(!transform.isAffine()
+		|| transform[0][1] != 0.0f
+		|| transform[1][0] != 0.0f
+		|| scale <= 0.0f
+		|| std::abs(transform[1][1] - scale) > 1e-4f * scale)
+		return false;
+
+	Rml::Vector4f radii;
+	if(!rounded_rectangle(geometry, radii))
+		return false;
+
+	Rml::Vector2f centre = (geometry.bounds.p0 + geometry.bounds.p1) * 0.5f + translation;
+	Rml::Vector2f halfSize = geometry.bounds.Size() * (0.5f * scale);
+	Ogre::Vector3 screenCentre = transform * Ogre::Vector3{centre.x, centre.y, 0.0f};
+	clip.rect = Ogre::Vector4{screenCentre.x, screenCentre.y, halfSize.x, halfSize.y};
+	clip.radii = Ogre::Vector4{radii.x, radii.y, radii.z, radii.w} * scale;
+	return true;
+}
+
+void RenderInterface::updateClipping()
+{
+	RenderPassSettings& settings = this->renderPassSettings;
+	settings.enableScissor = this->enableScissor;
+	settings.scissorRegion = this->scissorRegion;
+	settings.enableStencil = this->enableClipMask && !this->stencilClips.empty();
+	if(this->enableClipMask && this->clipMaskRegion.Valid())
+	{
+		settings.scissorRegion = this->enableScissor
+			? intersection(this->scissorRegion, this->clipMaskRegion)
+			: this->clipMaskRegion;
+		settings.enableScissor = true;
+	}
+}
+
+void RenderInterface::clearStencilClips()
+{
+	std::size_t skipped = this->stencilClips.size() - this->writtenStencilClips;
+	// Clipped to in the pixel shader instead
+	if(this->roundedClip && this->roundedClip->used && this->writtenStencilClips == 0)
+		--skipped;
+	this->clipMaskStats.skippedStencilClips += skipped;
+	this->stencilClips.clear();
+	this->writtenStencilClips = 0;
+	this->stencilClipHulls.clear();
+	this->stencilClipsConvex = false;
+	this->roundedClip.reset();
+}
+
+void RenderInterface::writeStencilClips()
+{
+	if(this->writtenStencilClips == this->stencilClips.size())
+		return;
+
+	// Stencil still holds the first clips, such as when a sibling element was clipped the same way
+	if(this->writtenStencilClips == 0
+		&& this->stencilContents.size() <= this->stencilClips.size()
+		&& std::equal(this->stencilContents.begin(), this->stencilContents.end(), this->stencilClips.begin()))
+	{
+		this->writtenStencilClips = this->stencilContents.size();
+		this->clipMaskStats.reusedStencilClips += this->stencilContents.size();
+	}
+
+	RenderPassSettings settings = this->renderPassSettings;
+	Ogre::Matrix4 drawTransform = this->drawTransform;
+	for(std::size_t i = this->writtenStencilClips; i < this->stencilClips.size(); ++i)
+	{
+		const StencilClip& clip = this->stencilClips[i];
+		this->renderPassSettings = clip.settings;
+		this->drawTransform = clip.drawTransform;
+
+		auto& compiledGeometry = this->geometries.at(clip.geometry);
+		QueuedGeometry queued{
+			compiledGeometry.vao,
+			clip.translation,
+			this->materials[0],
+			this->screenBounds(compiledGeometry, clip.translation),
+			clip.drawTransform
+		};
+		switch(clip.operation)
+		{
+		case Rml::ClipMaskOperation::Set:
+			this->getRenderPass<RenderToStencilSetPass>().queue.push_back(std::move(queued));
+			break;
+		case Rml::ClipMaskOperation::SetInverse:
+			this->getRenderPass<RenderToStencilSetInversePass>().queue.push_back(std::move(queued));
+			break;
+		case Rml::ClipMaskOperation::Intersect:
+			this->getRenderPass<RenderToStencilIntersectPass>().queue.push_back(std::move(queued));
+			break;
+		}
+		++this->clipMaskStats.stencilClips;
+	}
+	this->renderPassSettings = settings;
+	this->drawTransform = drawTransform;
+	this->writtenStencilClips = this->stencilClips.size();
+	this->stencilContents = this->stencilClips;
+}
+
+RenderInterface::DrawClip RenderInterface::clipDraw(const Rml::Rectanglef* bounds, bool shaderClip)
+{
+	if(!this->enableClipMask || this->stencilClips.empty())
+		return DrawClip::NONE;
+
+	if(bounds && this->stencilClipsConvex)
+	{
+		std::array<Rml::Vector2f, 4> corners{
+			bounds->p0,
+			Rml::Vector2f{bounds->p1.x, bounds->p0.y},
+			Rml::Vector2f{bounds->p0.x, bounds->p1.y},
+			bounds->p1
+		};
+		// Inside a convex hull when all corners are strictly inside
+		auto inside = [&corners](const std::vector<Rml::Vector2f>& hull) {
+			for(std::size_t i = 0; i < hull.size(); ++i)
+				for(auto& corner : corners)
+					if(cross(hull[i], hull[(i + 1) % hull.size()], corner) <= 0.0f)
+						return false;
+			return true;
+		};
+		if(std::all_of(this->stencilClipHulls.begin(), this->stencilClipHulls.end(), inside))
+		{
+			++this->clipMaskStats.unclippedDraws;
+			return DrawClip::NONE;
+		}
+	}
+
+	if(shaderClip && this->roundedClip && this->stencilClips.size() == 1)
+	{
+		if(!std::exchange(this->roundedClip->used, true))
+			++this->clipMaskStats.shaderClips;
+		return DrawClip::SHADER;
+	}
+
+	this->writeStencilClips();
+	return DrawClip::STENCIL;
+}
+
+BaseRenderPass& RenderInterface::getDrawPass(const Rml::Rectanglef& bounds, bool shaderClip)
+{
+	DrawClip clip = this->clipDraw(&bounds, shaderClip);
+	RenderPassSettings settings = this->renderPassSettings;
+	this->renderPassSettings.enableStencil = clip == DrawClip::STENCIL;
+	if(clip == DrawClip::SHADER)
+	{
+		this->renderPassSettings.enableRoundedClip = true;
+		this->renderPassSettings.roundedClipRect = this->roundedClip->rect;
+		this->renderPassSettings.roundedClipRadii = this->roundedClip->radii;
+	}
+	BaseRenderPass* pass = nullptr;
+	if(clip == DrawClip::STENCIL)
+		pass = &this->getRenderPass<RenderWithStencilPass>(&bounds);
+	else
+		pass = &this->getRenderPass<RenderPass>(&bounds);
+	this->renderPassSettings = settings;
+	return *pass;
+}
+
+void RenderInterface::startPass(BaseRenderPass& pass, const Rml::Rectanglef* bounds) const
+{
+	pass.settings = this->renderPassSettings;
+	pass.drawsInsideScissor = bounds && !scissorClips(pass.settings, *bounds);
+}
+
+bool RenderInterface::joinPass(BaseRenderPass& pass, const Rml::Rectanglef* bounds) const
+{
+	bool inside = bounds && !scissorClips(this->renderPassSettings, *bounds);
+	if(pass.settings == this->renderPassSettings)
+	{
+		pass.drawsInsideScissor = pass.drawsInsideScissor && inside;
+		return true;
+	}
+	if(!inside || !pass.settings.equalsIgnoringScissor(this->renderPassSettings))
+		return false;
+
+	if(!scissorClips(pass.settings, *bounds))
+		return true;
+	if(!pass.drawsInsideScissor)
+		return false;
+
+	// Only clips what the pass's draws cover, which is nothing
+	if(!this->renderPassSettings.enableScissor)
+		pass.settings.enableScissor = false;
+	else if(pass.settings.enableScissor)
+	{
+		const Rml::Rectanglei& a = pass.settings.scissorRegion;
+		const Rml::Rectanglei& b = this->renderPassSettings.scissorRegion;
+		pass.settings.scissorRegion = Rml::Rectanglei::FromCorners(
+			Rml::Vector2i{std::min(a.p0.x, b.p0.x), std::min(a.p0.y, b.p0.y)},
+			Rml::Vector2i{std::max(a.p1.x, b.p1.x), std::max(a.p1.y, b.p1.y)});
+	}
+	return true;
+}
+
+const Material& RenderInterface::getOpacityMaterial(const Material& material, Ogre::uint8 alpha)
+{
+	auto key = std::make_pair(material.datablock, alpha);
+	auto opacityMaterial = this->opacityMaterials.find(key);
+	if(opacityMaterial != this->opacityMaterials.end())
+	{
+		opacityMaterial->second.lastUsed = this->frame;
+		return opacityMaterial->second.material;
+	}
+
+	Ogre::String id = this->workspace.getNameStr();
+	id.append("_Texture_");
+	id.append(std::to_string(this->datablockId++));
+	auto* datablock = static_cast<Ogre::HlmsUnlitDatablock*>(material.datablock->clone(id));
+	// Colours are premultiplied so scale all channels
+	float value = alpha / 255.0f;
+	datablock->setColour(Ogre::ColourValue(value, value, value, value));
+
+	Material newMaterial{nullptr, datablock, material.textureDependency};
+	newMaterial.calculateHlmsHash();
+	return this->opacityMaterials.emplace(key, OpacityMaterial{std::move(newMaterial), this->frame})
+		.first->second.material;
+}
+
+bool RenderInterface::foldLayerOpacity(float opacity)
+{
+	static constexpr std::size_t MAX_FOLDED_DRAWS = 32;
+
+	if(opacity < 0.0f || opacity > 1.0f)
+		return false;
+
+	// Compositing clips to the current scissor and stencil, the layer's draws
+	// must already be clipped at least as much to be rendered without it
+	const RenderPassSettings& compositeSettings = this->renderPassSettings;
+	Rml::Rectanglef compositeRegion = this->clipRegion(compositeSettings);
+	std::vector<Rml::Rectanglef> drawBounds;
+	std::size_t layerStart = this->passes.size();
+	for(; layerStart > 0; --layerStart)
+	{
+		Pass& pass = this->passes[layerStart - 1];
+		if(std::holds_alternative<StartLayerPass>(pass))
+			break;
+
+		BaseRenderPass* renderPass = std::get_if<RenderPass>(&pass);
+		if(!renderPass)
+			renderPass = std::get_if<RenderWithStencilPass>(&pass);
+		if(!renderPass)
+			return false;
+
+		const RenderPassSettings& settings = renderPass->settings;
+		if(compositeSettings.enableStencil
+			&& (!settings.enableStencil || settings.stencilRefValue != compositeSettings.stencilRefValue))
+			return false;
+
+		Rml::Rectanglef region = this->clipRegion(settings);
+		for(auto& queued : renderPass->queue)
+		{
+			// Shader materials have no colour to scale
+			if(queued.material.material)
+				return false;
+
+			Rml::Rectanglef bounds = intersection(queued.bounds, region);
+			if(!contains(compositeRegion, bounds))
+				return false;
+			drawBounds.push_back(bounds);
+		}
+	}
+	if(layerStart < 2)
+		return false;
+
+	// Blending is associative, so only partially transparent draws must not
+	// overlap. Otherwise they would blend with each other after being faded.
+	if(opacity > 0.0f && opacity < 1.0f)
+	{
+		if(drawBounds.size() > MAX_FOLDED_DRAWS)
+			return false;
+		for(std::size_t i = 0; i < drawBounds.size(); ++i)
+			for(std::size_t j = i + 1; j < drawBounds.size(); ++j)
+				if(overlaps(drawBounds[i], drawBounds[j]))
+					return false;
+	}
+
+	if(opacity == 0.0f)
+	{
+		// Leave the layer empty so it's elided
+		this->passes.erase(this->passes.begin() + layerStart, this->passes.end());
+		return true;
+	}
+
+	float steps = OPACITY_STEPS;
+	Ogre::uint8 alpha = static_cast<Ogre::uint8>(std::round(std::round(opacity * steps) / steps * 255.0f));
+	if(alpha != 255)
+		for(std::size_t i = layerStart; i < this->passes.size(); ++i)
+		{
+			BaseRenderPass* renderPass = std::get_if<RenderPass>(&this->passes[i]);
+			if(!renderPass)
+				renderPass = &std::get<RenderWithStencilPass>(this->passes[i]);
+			for(auto& queued : renderPass->queue)
+				queued.material = this->getOpacityMaterial(queued.material, alpha);
+		}
+
+	// Move the draws before the layer's swap so they render to the layer below,
+	// leaving the layer empty so it's elided when popped
+	assert(std::holds_alternative<SwapPass>(this->passes[layerStart - 2]));
+	std::rotate(
+		this->passes.begin() + (layerStart - 2),
+		this->passes.begin() + layerStart,
+		this->passes.end());
+	return true;
+}
+
+Ogre::MaterialPtr RenderInterface::applyFilters(
+	Rml::Span<const Rml::CompiledFilterHandle> filters,
+	bool noBlending,
+	bool applyAll)
+{
+	std::vector<Filter*> appliedFilters;
+	for(std::size_t i = 0; i < filters.size();)
+	{
+		std::size_t runEnd = i;
+		Ogre::Matrix4 matrix = Ogre::Matrix4::IDENTITY;
+		for(; runEnd < filters.size(); ++runEnd)
+		{
+			auto* colourMatrixFilter = dynamic_cast<ColourMatrixFilter*>(this->filters.at(filters[runEnd]).get());
+			if(!colourMatrixFilter)
+				break;
+			matrix = colourMatrixFilter->getMatrix() * matrix;
+		}
+
+		if(runEnd - i < 2)
+		{
+			appliedFilters.push_back(this->filters.at(filters[i]).get());
+			++i;
+			continue;
+		}
+
+		// Apply consecutive colour matrices as their product in a single pass
+		std::vector<Rml::CompiledFilterHandle> run(filters.data() + i, filters.data() + runEnd);
+		auto fusedFilter = this->fusedFilters.find(run);
+		if(fusedFilter == this->fusedFilters.end())
+			fusedFilter = this->fusedFilters.emplace(std::move(run), this->colourMatrixFilterMaker.make(matrix)).first;
+		appliedFilters.push_back(fusedFilter->second.get());
+		i = runEnd;
+	}
+
+	if(appliedFilters.empty())
+		return {};
+
+	for(std::size_t i = 0; i + 1 < appliedFilters.size(); ++i)
+		appliedFilters[i]->apply(*this);
+
+	// Apply the last filter while compositing when possible
+	Ogre::MaterialPtr compositeMaterial;
+	if(!applyAll)
+		compositeMaterial = appliedFilters.back()->getCompositeMaterial(*this, noBlending);
+	if(!compositeMaterial)
+		appliedFilters.back()->apply(*this);
+	return compositeMaterial;
+}
+
+bool RenderInterface::isFilterCacheable(Rml::Span<const Rml::CompiledFilterHandle> filters)
+{
+	// Single pass filters cost less to apply than to cache
+	return std::any_of(filters.begin(), filters.end(), [this](Rml::CompiledFilterHandle filter) {
+		return !dynamic_cast<SingleMaterialFilter*>(this->filters.at(filter).get());
+	});
+}
+
+std::size_t RenderInterface::describeLayerContent(
+	std::string& key,
+	std::vector<const void*>& resources,
+	std::vector<Rml::CompiledShaderHandle>& shaders) const
+{
+	std::size_t layerStart = this->passes.size();
+	for(; layerStart > 0; --layerStart)
+		if(std::holds_alternative<StartLayerPass>(this->passes[layerStart - 1]))
+			break;
+	if(layerStart == 0 || layerStart == this->passes.size())
+		return 0;
+
+	for(std::size_t i = layerStart; i < this->passes.size(); ++i)
+	{
+		// Stencils and nested layers depend on more than the layer's draws
+		const auto* renderPass = std::get_if<RenderPass>(&this->passes[i]);
+		if(!renderPass)
+			return 0;
+
+		const RenderPassSettings& settings = renderPass->settings;
+		append_bytes(key, &settings.enableScissor, sizeof(settings.enableScissor));
+		append_bytes(key, &settings.scissorRegion, sizeof(settings.scissorRegion));
+		append_bytes(key, settings.transform[0], 16 * sizeof(Ogre::Real));
+		append_bytes(key, &settings.enableRoundedClip, sizeof(settings.enableRoundedClip));
+		append_bytes(key, settings.roundedClipRect.ptr(), 4 * sizeof(Ogre::Real));
+		append_bytes(key, settings.roundedClipRadii.ptr(), 4 * sizeof(Ogre::Real));
+		for(auto& queued : renderPass->queue)
+		{
+			const Material& material = queued.material;
+			// Render textures are rendered again every frame
+			if(material.textureDependency)
+				return 0;
+			// Don't keep output rendered before a texture is loaded
+			if(material.datablock)
+			{
+				auto* texture = static_cast<Ogre::HlmsUnlitDatablock*>(material.datablock)->getTexture(0);
+				if(texture && !texture->isDataReady())
+					return 0;
+			}
+
+			const void* shader = material.material.get();
+			append_bytes(key, &queued.vao, sizeof(queued.vao));
+			append_bytes(key, &queued.translation, sizeof(queued.translation));
+			append_bytes(key, queued.transform[0], 16 * sizeof(Ogre::Real));
+			append_bytes(key, &material.datablock, sizeof(material.datablock));
+			append_bytes(key, &shader, sizeof(shader));
+			append_bytes(key, material.customParameters.data(),
+				material.numCustomParameters * sizeof(Ogre::Vector4));
+			resources.push_back(queued.vao);
+			if(material.datablock)
+				resources.push_back(material.datablock);
+			// Other shaders share the material, their outputs stay valid
+			if(queued.shader)
+				shaders.push_back(*queued.shader);
+			else if(shader)
+				resources.push_back(shader);
+		}
+	}
+	return layerStart;
+}
+
+Ogre::MaterialPtr RenderInterface::getCachedLayerMaterial(
+	FilterCache::Entry& entry,
+	const Rml::Rectanglei& region,
+	bool noBlending)
+{
+	auto& material = entry.materials[noBlending ? 1 : 0];
+	if(!material)
+	{
+		float width = this->workspace.width();
+		float height = this->workspace.height();
+		// Output is in the top left of a possibly larger pooled texture
+		Ogre::Vector2 used = used_fraction(region.Size(), entry.texture);
+		material = this->materialCache.acquire(this->cachedLayerMaterial, {
+			{Ogre::GPT_FRAGMENT_PROGRAM, "cacheTex", entry.texture},
+			{Ogre::GPT_FRAGMENT_PROGRAM, "region", Ogre::Vector4{
+				region.Left() / width,
+				region.Top() / height,
+				region.Width() / width / used.x,
+				region.Height() / height / used.y
+			}}
+		}, !noBlending);
+	}
+	return material;
+}
+
+void RenderInterface::releaseFilterCacheEntries()
+{
+	for(auto& entry : this->filterCache.takeEvicted())
+	{
+		this->releaseRenderTexture(entry.texture);
+		for(auto& material : entry.materials)
+			if(material)
+				this->materialCache.release(material);
+	}
+}
+
+std::pair<Ogre::TextureGpu*, std::size_t> RenderInterface::getRenderTexture(
+	Rml::Vector2i dimensions,
+	Ogre::PixelFormatGpu pixelFormat)
+{
+	RenderTexturePool::Format format;
+	format.width = std::max(dimensions.x, 1);
+	format.height = std::max(dimensions.y, 1);
+	format.pixelFormat = pixelFormat;
+	return this->workspace.getRenderTexture(format);
+}
+
 Layer RenderInterface::getLayerBuffer(int index)
 {
 	if(index < 0)
@@ -168,11 +1034,40 @@ void RenderInterface::releaseLayerBuffer(Layer layer)
 }
 
 
+Rml::String RenderInterface::ExportTextureMetadata() const
+{
+	std::ostringstream stream;
+	for(auto& metadata : this->textureMetadata)
+		stream << metadata.second.x << ' ' << metadata.second.y << ' ' << metadata.first << '\n';
+	return stream.str();
+}
+void RenderInterface::ImportTextureMetadata(const Rml::String& metadata)
+{
+	std::istringstream stream(metadata);
+	Rml::Vector2i dimensions;
+	Rml::String source;
+	while(stream >> dimensions.x >> dimensions.y && std::getline(stream >> std::ws, source))
+	{
+		if(dimensions.x > 0 && dimensions.y > 0 && !source.empty())
+			this->textureMetadata.emplace(std::move(source), dimensions);
+	}
+}
+
+
 void RenderInterface::BeginFrame()
 {
 	this->workspace.clearAll();
+	this->filterCache.beginFrame();
 	this->releaseBufferedGeometries();
+	this->updateTextureMetadata();
 	this->releaseBufferedTextures();
+	this->workspace.shrinkRenderTextures(RENDER_TEXTURE_SHRINK_FRAMES);
+	++this->frame;
+	this->evictTextures();
+	this->evictOpacityMaterials();
+	this->materialCache.update();
+	this->gradientAtlas.update();
+	this->textureAtlas.update();
 
 	this->numActiveLayers = 1;
 	this->layerBuffers.push_back(Layer{-1, -1});
@@ -180,20 +1075,39 @@ void RenderInterface::BeginFrame()
 
 void RenderInterface::EndFrame()
 {
+	this->clearStencilClips();
+	this->stencilContents.clear();
 	this->workspace.populateWorkspace(this->passes);
 
 	this->passes.clear();
 	this->layerBuffers.clear();
 	this->numActiveLayers = 0;
 	this->renderPassSettings = RenderPassSettings{};
+	this->drawTransform = Ogre::Matrix4::IDENTITY;
+	this->enableScissor = false;
+	this->enableClipMask = false;
+	this->clipMaskRegion = Rml::Rectanglei::MakeInvalid();
 	this->connectionId = 0;
 }
 
 
 void RenderInterface::AddFilterMaker(Rml::String name, std::unique_ptr<FilterMaker> filterMaker)
 {
+	filterMaker->setMaterialCache(&this->materialCache);
 	this->filterMakers.emplace(std::move(name), std::move(filterMaker));
 }
+void RenderInterface::SetBlurSettings(const BlurSettings& settings)
+{
+	// Either may have been replaced by other makers
+	auto blur = this->filterMakers.find("blur");
+	if(blur != this->filterMakers.end())
+		if(auto* maker = dynamic_cast<BlurFilterMaker*>(blur->second.get()))
+			maker->setSettings(settings);
+	auto dropShadow = this->filterMakers.find("drop-shadow");
+	if(dropShadow != this->filterMakers.end())
+		if(auto* maker = dynamic_cast<DropShadowFilterMaker*>(dropShadow->second.get()))
+			maker->getBlurFilterMaker().setSettings(settings);
+}
 void RenderInterface::AddShaderMaker(Rml::String name, std::unique_ptr<ShaderMaker> shaderMaker)
 {
 	this->shaderMakers.emplace(std::move(name), std::move(shaderMaker));
@@ -214,26 +1128,35 @@ Rml::CompiledGeometryHandle RenderInterface::CompileGeometry(
 	Rml::Span<const Rml::Vertex> vertices,
 	Rml::Span<const int> indices)
 {
-	return reinterpret_cast<Rml::CompiledGeometryHandle>(create_vao(vertices, indices));
+	return this->geometries.insert(create_geometry(vertices, indices));
 }
 void RenderInterface::RenderGeometry(
 	Rml::CompiledGeometryHandle geometry,
 	Rml::Vector2f translation,
 	Rml::TextureHandle texture)
 {
-	BaseRenderPass* pass = nullptr;
-	if(this->renderPassSettings.enableStencil)
-		pass = &this->getRenderPass<RenderWithStencilPass>();
-	else
-		pass = &this->getRenderPass<RenderPass>();
+	auto& compiledGeometry = this->geometries.at(geometry);
+	Rml::Rectanglef bounds = this->screenBounds(compiledGeometry, translation);
+	// Skip geometry entirely outside the scissor region, so layers holding
+	// only clipped geometry are left empty and can be elided
+	if(!this->isVisible(bounds))
+		return;
+	// Wrapping samples neighbouring images in the atlas
+	if(compiledGeometry.wrapsTexCoords)
+		this->unpackAtlasTexture(texture);
 
 	auto& material = this->materials.at(texture);
 	if(material.needsHashing())
 		material.calculateHlmsHash();
+	// Hlms materials can be clipped in the pixel shader
+	BaseRenderPass* pass = &this->getDrawPass(bounds, !material.material);
+	this->useTexture(texture);
 	pass->queue.push_back({
-		reinterpret_cast<Ogre::VertexArrayObject*>(geometry),
+		compiledGeometry.vao,
 		translation,
-		material
+		material,
+		bounds,
+		this->drawTransform
 	});
 	if(material.textureDependency)
 		pass->textureDependencies.push_back(material.textureDependency);
@@ -244,31 +1167,182 @@ void RenderInterface::ReleaseGeometry(Rml::CompiledGeometryHandle geometry)
 }
 
 
-Rml::TextureHandle RenderInterface::LoadTexture(
+Rml::TextureHandle RenderInterface::loadAtlasTexture(
 	Rml::Vector2i& texture_dimensions,
 	const Rml::String& source)
 {
-	Ogre::TextureGpuManager* textureManager = Ogre::Root::getSingleton()
-		.getRenderSystem()
-		->getTextureGpuManager();
-	Ogre::TextureGpu* texture = nullptr;
-	if(!source.empty())
+	// Only images known to be small are decoded here, without waiting for
+	// the loading thread. Others are streamed in the background as usual.
+	auto metadata = this->textureMetadata.find(source);
+	if(metadata == this->textureMetadata.end()
+		|| std::uint32_t(metadata->second.x) > this->textureAtlasThreshold
+		|| std::uint32_t(metadata->second.y) > this->textureAtlasThreshold)
+		return {};
+	if(!Ogre::ResourceGroupManager::getSingleton().resourceExistsInAnyGroup(source))
+		return {};
+
+	Ogre::Image2 image;
+	try
+	{
+		image.load(source, Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+	}
+	catch(const Ogre::Exception&)
+	{
+		// Left to the normal loading path, which handles failures
+		return {};
+	}
+	Ogre::uint32 width = image.getWidth();
+	Ogre::uint32 height = image.getHeight();
+	this->textureMetadata[source] = Rml::Vector2i(width, height);
+	if(width > this->textureAtlasThreshold
+		|| height > this->textureAtlasThreshold
+		|| Ogre::PixelFormatGpuUtils::isCompressed(image.getPixelFormat()))
+		return {};
+
+	std::vector<Ogre::uint8> texels(width * height * 4);
+	Ogre::TextureBox box(width, height, 1u, 1u, 4u, width * 4u, width * height * 4u);
+	box.data = texels.data();
+	Ogre::PixelFormatGpuUtils::bulkPixelConversion(
+		image.getData(0), image.getPixelFormat(),
+		box, Ogre::PixelFormatGpu::PFG_RGBA8_UNORM);
+	// Premultiplied like loaded textures
+	for(std::size_t i = 0; i < texels.size(); i += 4)
+		for(std::size_t c = 0; c < 3; ++c)
+			texels[i + c] = (texels[i + c] * texels[i + 3] + 127) / 255;
+
+	auto region = this->textureAtlas.add(texels.data(), width, height);
+	if(!region.texture)
+		return {};
+
+	Ogre::String id = this->workspace.getNameStr();
+	id.append("_Texture_");
+	id.append(std::to_string(this->datablockId++));
+	auto* datablock = static_cast<Ogre::HlmsUnlitDatablock*>(
+		this->hlms->createDatablock(id, id, this->macroblock, this->blendblock, Ogre::HlmsParamVec()));
+	datablock->setTexture(0, region.texture, &this->samplerblock);
+	datablock->setEnableAnimationMatrix(0, true);
+	datablock->setAnimationMatrix(0, region.uvTransform());
+	datablock->setUseColour(true);
+
+	auto material = Material{nullptr, datablock};
+	material.calculateHlmsHash();
+	auto handle = this->materials.insert(std::move(material));
+
+	++this->textureLoadStats.loads;
+	texture_dimensions = Rml::Vector2i(width, height);
+	this->atlasRegions.emplace(handle, region);
+	this->loadedTextures.emplace(source, LoadedTexture{handle, texture_dimensions, 1, nullptr});
+	this->useTexture(handle);
+	this->loadedTextureSources.emplace(handle, source);
+	return handle;
+}
+void RenderInterface::unpackAtlasTexture(Rml::TextureHandle handle)
+{
+	auto atlasRegion = this->atlasRegions.find(handle);
+	if(atlasRegion == this->atlasRegions.end())
+		return;
+
+	const Rml::String& source = this->loadedTextureSources.at(handle);
+	LoadedTexture& loaded = this->loadedTextures.at(source);
+	loaded.texture = this->streamTexture(source);
+	this->unpackedSources.insert(source);
+
+	Ogre::String id = this->workspace.getNameStr();
+	id.append("_Texture_");
+	id.append(std::to_string(this->datablockId++));
+	auto* datablock = static_cast<Ogre::HlmsUnlitDatablock*>(
+		this->hlms->createDatablock(id, id, this->macroblock, this->blendblock, Ogre::HlmsParamVec()));
+	datablock->setTexture(0, loaded.texture, &this->samplerblock);
+	datablock->setUseColour(true);
+
+	// Old datablock may still be drawn with this frame, so is destroyed with released textures
+	Material& material = this->materials.at(handle);
+	this->releaseDatablocks.push_back(material.datablock);
+	material = Material{nullptr, datablock};
+	material.calculateHlmsHash();
+
+	this->textureAtlas.release(atlasRegion->second);
+	this->atlasRegions.erase(atlasRegion);
+}
+
+Ogre::TextureGpu* RenderInterface::streamTexture(const Rml::String& source)
+{
+	auto metadata = this->textureMetadata.find(source);
+	Ogre::uint32 filters = Ogre::TextureFilter::TypePremultiplyAlpha;
+	if(this->textureMipmapThreshold > 0
+		&& (metadata == this->textureMetadata.end()
+			|| std::uint32_t(metadata->second.x) > this->textureMipmapThreshold
+			|| std::uint32_t(metadata->second.y) > this->textureMipmapThreshold))
 	{
-		texture = textureManager->createTexture(
+		// Generated on the loading thread, if the image has no mipmaps
+		filters |= Ogre::TextureFilter::TypeGenerateDefaultMipmaps;
+		++this->textureLoadStats.mipmappedLoads;
+	}
+
+	Ogre::TextureGpu* texture = Ogre::Root::getSingleton()
+		.getRenderSystem()
+		->getTextureGpuManager()
+		->createTexture(
 			source,
 			Ogre::GpuPageOutStrategy::Discard,
 			Ogre::TextureFlags::AutomaticBatching,
 			Ogre::TextureTypes::Type2D,
 			Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME,
-			Ogre::TextureFilter::TypePremultiplyAlpha);
-		texture->scheduleTransitionTo(Ogre::GpuResidency::Resident);
+			filters);
+	texture->scheduleTransitionTo(Ogre::GpuResidency::Resident);
+	return texture;
+}
+
+Rml::TextureHandle RenderInterface::LoadTexture(
+	Rml::Vector2i& texture_dimensions,
+	const Rml::String& source)
+{
+	auto loaded = this->loadedTextures.find(source);
+	if(loaded != this->loadedTextures.end())
+	{
+		// Released this frame but not destroyed yet
+		if(loaded->second.references++ == 0)
+			this->releaseTextures.erase(std::find(
+				this->releaseTextures.begin(),
+				this->releaseTextures.end(),
+				loaded->second.handle));
+		texture_dimensions = loaded->second.dimensions;
+		return loaded->second.handle;
 	}
 
+	if(this->textureAtlasThreshold > 0
+		&& !source.empty()
+		&& this->unpackedSources.count(source) == 0)
+	{
+		Rml::TextureHandle handle = this->loadAtlasTexture(texture_dimensions, source);
+		if(handle)
+			return handle;
+	}
+
+	auto metadata = this->textureMetadata.find(source);
+	Ogre::TextureGpu* texture = nullptr;
+	if(!source.empty())
+		texture = this->streamTexture(source);
+
 	if(!texture)
 		return Rml::TextureHandle{};
 
-	texture->waitForMetadata();
-	texture_dimensions = Rml::Vector2i(texture->getWidth(), texture->getHeight());
+	++this->textureLoadStats.loads;
+	if(metadata != this->textureMetadata.end() && !texture->isMetadataReady())
+	{
+		// Texture is shown as blank until it's loaded in the background
+		texture_dimensions = metadata->second;
+		this->pendingTextureMetadata.emplace_back(source, texture);
+		++this->textureLoadStats.metadataCacheHits;
+	}
+	else
+	{
+		if(!texture->isMetadataReady())
+			++this->textureLoadStats.blockingWaits;
+		texture->waitForMetadata();
+		texture_dimensions = Rml::Vector2i(texture->getWidth(), texture->getHeight());
+		this->textureMetadata[source] = texture_dimensions;
+	}
 
 	Ogre::String id = this->workspace.getNameStr();
 	id.append("_Texture_");
@@ -281,6 +1355,9 @@ Rml::TextureHandle RenderInterface::LoadTexture(
 	auto material = Material{nullptr, datablock};
 	material.calculateHlmsHash();
 	auto handle = this->materials.insert(std::move(material));
+	this->loadedTextures.emplace(source, LoadedTexture{handle, texture_dimensions, 1, texture});
+	this->useTexture(handle);
+	this->loadedTextureSources.emplace(handle, source);
 	return handle;
 }
 Rml::TextureHandle RenderInterface::GenerateTexture(
@@ -291,36 +1368,23 @@ Rml::TextureHandle RenderInterface::GenerateTexture(
 	id.append("_Texture_");
 	id.append(std::to_string(this->datablockId++));
 
-	std::size_t size = Ogre::PixelFormatGpuUtils::calculateSizeBytes(
-        source_dimensions.x, source_dimensions.y, 1u, 1u, Ogre::PixelFormatGpu::PFG_RGBA8_UNORM_SRGB, 1u, 4u);
-	Ogre::uint8* data = reinterpret_cast<Ogre::uint8*>(
-		OGRE_MALLOC_SIMD(size, Ogre::MEMCATEGORY_GENERAL));
-	std::copy(source.begin(), source.end(), data);
-
-	auto* image = OGRE_NEW Ogre::Image2;
-	image->loadDynamicImage(
-		data,
-		source_dimensions.x,
-		source_dimensions.y,
-		1u,
-		Ogre::TextureTypes::Type2D,
-		Ogre::PixelFormatGpu::PFG_RGBA8_UNORM,
-		true,
-		1u);
-
+	// Uploaded straight from source, without a system RAM copy. Batched into
+	// texture arrays like loaded textures, so draws of generated textures with
+	// the same dimensions only differ by the array slice of their datablocks
+	// and don't need their textures bound again.
 	Ogre::TextureGpuManager& textureManager = *Ogre::Root::getSingleton().getRenderSystem()
 		->getTextureGpuManager();
 	Ogre::TextureGpu* texture = textureManager.createTexture(
 		id,
-		Ogre::GpuPageOutStrategy::AlwaysKeepSystemRamCopy,
-		Ogre::TextureFlags::AutomaticBatching,
+		Ogre::GpuPageOutStrategy::Discard,
+		Ogre::TextureFlags::ManualTexture | Ogre::TextureFlags::AutomaticBatching,
 		Ogre::TextureTypes::Type2D,
 		Ogre::BLANKSTRING);
 	texture->setNumMipmaps(1);
 	texture->setResolution(source_dimensions.x, source_dimensions.y);
 	texture->setPixelFormat(Ogre::PixelFormatGpu::PFG_RGBA8_UNORM);
-
-	texture->scheduleTransitionTo(Ogre::GpuResidency::Resident, image);
+	texture->scheduleTransitionTo(Ogre::GpuResidency::Resident);
+	upload_texture_region(texture, source, Rml::Rectanglei::FromSize(source_dimensions));
 
 	auto* datablock = static_cast<Ogre::HlmsUnlitDatablock*>(
 		this->hlms->createDatablock(id, id, this->macroblock, this->blendblock, Ogre::HlmsParamVec()));
@@ -332,39 +1396,116 @@ Rml::TextureHandle RenderInterface::GenerateTexture(
 	auto handle = this->materials.insert(std::move(material));
 	return handle;
 }
+bool RenderInterface::UpdateTexture(
+	Rml::TextureHandle texture,
+	Rml::Rectanglei region,
+	Rml::Span<const Rml::byte> source)
+{
+	if(!this->materials.has(texture))
+		return false;
+	auto* datablock = static_cast<Ogre::HlmsUnlitDatablock*>(this->materials.at(texture).datablock);
+	Ogre::TextureGpu* textureGpu = datablock->getTexture(0);
+	if(!textureGpu
+		|| !textureGpu->isManualTexture()
+		|| this->loadedTextureSources.count(texture) > 0
+		|| region.Left() < 0 || region.Top() < 0
+		|| region.Right() > int(textureGpu->getWidth())
+		|| region.Bottom() > int(textureGpu->getHeight())
+		|| source.size() != std::size_t(region.Width() * region.Height() * 4))
+		return false;
+
+	upload_texture_region(textureGpu, source, region);
+
+	// Cached filter outputs may have drawn the old contents
+	this->filterCache.invalidate(datablock);
+	for(auto& opacityMaterial : this->opacityMaterials)
+		if(opacityMaterial.first.first == datablock)
+			this->filterCache.invalidate(opacityMaterial.second.material.datablock);
+	this->releaseFilterCacheEntries();
+	return true;
+}
 void RenderInterface::ReleaseTexture(Rml::TextureHandle texture)
 {
+	auto source = this->loadedTextureSources.find(texture);
+	if(source != this->loadedTextureSources.end()
+		&& --this->loadedTextures.at(source->second).references > 0)
+		return;
+
 	this->releaseTextures.push_back(texture);
 }
 
 
 void RenderInterface::EnableScissorRegion(bool enable)
 {
-	this->renderPassSettings.enableScissor = enable;
+	this->enableScissor = enable;
+	this->updateClipping();
 }
 void RenderInterface::SetScissorRegion(Rml::Rectanglei region)
 {
-	this->renderPassSettings.scissorRegion = region;
+	this->scissorRegion = region;
+	this->updateClipping();
 }
 
 
 void RenderInterface::SetTransform(const Rml::Matrix4f* transform)
 {
-	this->renderPassSettings.transform = transform
+	Ogre::Matrix4 matrix = transform
 		? Ogre::Matrix4(transform->data()).transpose()
 		: Ogre::Matrix4::IDENTITY;
+	// Draws with different transforms can share a pass when their scene nodes hold them
+	if(is_node_transform(matrix))
+	{
+		this->drawTransform = matrix;
+		this->renderPassSettings.transform = Ogre::Matrix4::IDENTITY;
+	}
+	else
+	{
+		this->drawTransform = Ogre::Matrix4::IDENTITY;
+		this->renderPassSettings.transform = matrix;
+	}
 }
 
 
 void RenderInterface::EnableClipMask(bool enable)
 {
-	this->renderPassSettings.enableStencil = enable;
+	this->enableClipMask = enable;
+	this->updateClipping();
 }
 void RenderInterface::RenderToClipMask(
 	Rml::ClipMaskOperation operation,
 	Rml::CompiledGeometryHandle geometry,
 	Rml::Vector2f translation)
 {
+	auto& compiledGeometry = this->geometries.at(geometry);
+
+	// Rectangles are clipped to with the scissor region, skipping the stencil
+	Rml::Rectanglei region;
+	if(operation != Rml::ClipMaskOperation::SetInverse
+		&& this->screenRectangle(compiledGeometry, translation, region))
+	{
+		if(operation == Rml::ClipMaskOperation::Set || !this->clipMaskRegion.Valid())
+			this->clipMaskRegion = region;
+		else
+			this->clipMaskRegion = intersection(this->clipMaskRegion, region);
+		if(operation == Rml::ClipMaskOperation::Set)
+			this->clearStencilClips();
+		++this->clipMaskStats.scissorClips;
+		this->updateClipping();
+		return;
+	}
+
+	// Stencil doesn't hold the mask yet, only rectangles have been clipped to
+	if(operation == Rml::ClipMaskOperation::Intersect && this->stencilClips.empty())
+		operation = Rml::ClipMaskOperation::Set;
+	else if(operation != Rml::ClipMaskOperation::Intersect)
+		this->clipMaskRegion = Rml::Rectanglei::MakeInvalid();
+	if(operation != Rml::ClipMaskOperation::Intersect)
+	{
+		this->clearStencilClips();
+		this->stencilClipsConvex = operation == Rml::ClipMaskOperation::Set;
+	}
+	this->updateClipping();
+
 	switch(operation)
 	{
 	case Rml::ClipMaskOperation::Set:
@@ -378,30 +1519,23 @@ void RenderInterface::RenderToClipMask(
 		break;
 	}
 
-	switch(operation)
-	{
-	case Rml::ClipMaskOperation::Set:
-		this->getRenderPass<RenderToStencilSetPass>().queue.push_back({
-			reinterpret_cast<Ogre::VertexArrayObject*>(geometry),
-			translation,
-			this->materials[0]
-		});
-		break;
-	case Rml::ClipMaskOperation::SetInverse:
-		this->getRenderPass<RenderToStencilSetInversePass>().queue.push_back({
-			reinterpret_cast<Ogre::VertexArrayObject*>(geometry),
-			translation,
-			this->materials[0]
-		});
-		break;
-	case Rml::ClipMaskOperation::Intersect:
-		this->getRenderPass<RenderToStencilIntersectPass>().queue.push_back({
-			reinterpret_cast<Ogre::VertexArrayObject*>(geometry),
-			translation,
-			this->materials[0]
-		});
-		break;
-	}
+	this->stencilClips.push_back({
+		operation,
+		geometry,
+		translation,
+		this->renderPassSettings,
+		this->drawTransform
+	});
+	std::vector<Rml::Vector2f> hull;
+	if(this->stencilClipsConvex && this->screenHull(convex_hull(compiledGeometry), translation, hull))
+		this->stencilClipHulls.push_back(std::move(hull));
+	else
+		this->stencilClipsConvex = false;
+	RoundedClip rounded;
+	if(this->roundedClipListener
+		&& operation == Rml::ClipMaskOperation::Set
+		&& this->screenRoundedRectangle(compiledGeometry, translation, rounded))
+		this->roundedClip = rounded;
 
 	switch(operation)
 	{
@@ -418,7 +1552,8 @@ void RenderInterface::RenderToClipMask(
 
 Rml::LayerHandle RenderInterface::PushLayer()
 {
-	Layer oldTopLayer{this->addConnection(), -1};
+	// Keep copy pass so it can still be elided if this layer is elided
+	Layer oldTopLayer{this->addConnection(), this->layerBuffers.at(this->numActiveLayers - 1).copyPass};
 	this->putLayerBuffer(-1, oldTopLayer);
 	Layer newLayer = this->acquireLayerBuffer();
 	this->passes.push_back(SwapPass(newLayer.connectionId, oldTopLayer.connectionId));
@@ -432,13 +1567,73 @@ void RenderInterface::CompositeLayers(
 	Rml::BlendMode blend_mode,
 	Rml::Span<const Rml::CompiledFilterHandle> filters)
 {
+	bool sourceIsTopLayer = static_cast<int>(source) == this->numActiveLayers - 1;
+	bool destinationIsTopLayer = static_cast<int>(destination) == this->numActiveLayers - 1;
+
+	// Nothing has been rendered to the source layer since it was pushed,
+	// it's fully transparent so compositing it can't change the destination
+	bool sourceIsEmpty = sourceIsTopLayer
+		&& !this->passes.empty()
+		&& std::holds_alternative<StartLayerPass>(this->passes.back());
+	if(sourceIsEmpty && (blend_mode == Rml::BlendMode::Blend || source == destination))
+		return;
+
+	// A lone opacity filter onto the layer below can be folded into the draws
+	if(sourceIsTopLayer
+		&& static_cast<int>(destination) == this->numActiveLayers - 2
+		&& blend_mode == Rml::BlendMode::Blend
+		&& filters.size() == 1)
+	{
+		auto* opacityFilter = dynamic_cast<OpacityFilter*>(this->filters.at(filters[0]).get());
+		if(opacityFilter && this->foldLayerOpacity(opacityFilter->getValue()))
+			return;
+	}
+
+	// Reuse the output of multi-pass filters on a layer unchanged since a previous frame,
+	// or store it if the layer was also missed last frame
+	Rml::Rectanglei cacheRegion = this->renderPassSettings.enableScissor
+		? this->renderPassSettings.scissorRegion
+		: Rml::Rectanglei::FromSize(this->currentOutputSize());
+	std::string cacheKey;
+	std::vector<const void*> cacheResources;
+	std::vector<Rml::CompiledShaderHandle> cacheShaders;
+	FilterCache::Entry* cachedOutput = nullptr;
+	std::size_t cacheBytes = 0;
+	bool storeOutput = false;
+	if(sourceIsTopLayer
+		&& cacheRegion.Width() > 0
+		&& cacheRegion.Height() > 0
+		&& this->isFilterCacheable(filters))
+	{
+		std::size_t layerStart = this->describeLayerContent(cacheKey, cacheResources, cacheShaders);
+		if(layerStart > 0)
+		{
+			Rml::Vector2i outputSize = this->currentOutputSize();
+			append_bytes(cacheKey, filters.data(), filters.size() * sizeof(Rml::CompiledFilterHandle));
+			append_bytes(cacheKey, &cacheRegion, sizeof(cacheRegion));
+			append_bytes(cacheKey, &outputSize, sizeof(outputSize));
+
+			cachedOutput = this->filterCache.find(cacheKey);
+			if(cachedOutput)
+			{
+				// Only the cached output of the layer's draws is composited
+				this->passes.erase(this->passes.begin() + layerStart, this->passes.end());
+			}
+			else
+			{
+				cacheBytes = Ogre::PixelFormatGpuUtils::calculateSizeBytes(
+					cacheRegion.Width(), cacheRegion.Height(), 1u, 1u,
+					Ogre::PixelFormatGpu::PFG_RGBA8_UNORM_SRGB, 1u, 4u);
+				storeOutput = this->filterCache.shouldStore(cacheKey, cacheBytes);
+				this->releaseFilterCacheEntries();
+			}
+		}
+	}
+
 	Layer topLayer{this->addConnection(), -1};
 	Layer sourceLayer;
 	Layer destinationLayer;
 
-	bool sourceIsTopLayer = static_cast<int>(source) == this->numActiveLayers - 1;
-	bool destinationIsTopLayer = static_cast<int>(destination) == this->numActiveLayers - 1;
-
 	Layer tempLayer = this->acquireLayerBuffer();
 	if(sourceIsTopLayer)
 	{
@@ -470,26 +1665,51 @@ void RenderInterface::CompositeLayers(
 		this->putLayerBuffer(source, sourceLayer);
 
 
-	for(auto filter : filters)
-		this->filters.at(filter)->apply(*this);
+	bool noBlending = blend_mode == Rml::BlendMode::Replace;
+	Ogre::MaterialPtr compositeMaterial;
+	if(cachedOutput)
+		compositeMaterial = this->getCachedLayerMaterial(*cachedOutput, cacheRegion, noBlending);
+	else if(storeOutput)
+	{
+		this->applyFilters(filters, noBlending, true);
+
+		auto renderTexture = this->getRenderTexture(cacheRegion.Size());
+		this->passes.push_back(RenderToTexturePass(
+			renderTexture.second,
+			used_fraction(cacheRegion.Size(), renderTexture.first),
+			this->renderPassSettings));
+
+		FilterCache::Entry entry;
+		entry.texture = renderTexture.first;
+		entry.bytes = cacheBytes;
+		entry.resources = std::move(cacheResources);
+		entry.filters.assign(filters.begin(), filters.end());
+		entry.shaders = std::move(cacheShaders);
+		this->filterCache.store(std::move(cacheKey), std::move(entry));
+	}
+	else
+		compositeMaterial = this->applyFilters(filters, noBlending);
 
 
 	tempLayer = Layer{this->addConnection(), -1};
-	if(this->renderPassSettings.enableStencil)
+	Rml::Rectanglef compositeRegion = this->clipRegion(this->renderPassSettings);
+	if(this->clipDraw(&compositeRegion) == DrawClip::STENCIL)
 	{
 		this->passes.push_back(CompositeWithStencilPass(
 			destinationLayer.connectionId,
 			tempLayer.connectionId,
-			blend_mode == Rml::BlendMode::Replace,
-			this->renderPassSettings));
+			noBlending,
+			this->renderPassSettings,
+			compositeMaterial));
 	}
 	else
 	{
 		this->passes.push_back(CompositePass(
 			destinationLayer.connectionId,
 			tempLayer.connectionId,
-			blend_mode == Rml::BlendMode::Replace,
-			this->renderPassSettings));
+			noBlending,
+			this->renderPassSettings,
+			compositeMaterial));
 	}
 	this->releaseLayerBuffer(tempLayer);
 
@@ -503,6 +1723,21 @@ void RenderInterface::CompositeLayers(
 }
 void RenderInterface::PopLayer()
 {
+	// Layer was never rendered to or composited, remove its swap and clear passes
+	if(std::holds_alternative<StartLayerPass>(this->passes.back()))
+	{
+		this->passes.pop_back();
+		assert(std::holds_alternative<SwapPass>(this->passes.back()));
+		SwapPass swapPass = std::get<SwapPass>(this->passes.back());
+		this->passes.pop_back();
+
+		this->getLayerBuffer(-1);
+		assert(this->layerBuffers.at(this->numActiveLayers - 2).connectionId == swapPass.swapOut);
+		this->getLayerBuffer(-2);
+		this->releaseLayerBuffer(Layer{swapPass.swapIn, -1});
+		return;
+	}
+
 	Layer poppedLayer = this->getLayerBuffer(-1);
 	Layer newTopLayer = this->getLayerBuffer(-2);
 	auto* lastPass = std::get_if<SwapPass>(&this->passes.back());
@@ -555,6 +1790,19 @@ void RenderInterface::ReleaseFilter(Rml::CompiledFilterHandle filter)
 	auto& compiledFilter = this->filters.at(filter);
 	compiledFilter->release(*this);
 	this->filters.erase(filter);
+	this->filterCache.invalidate(filter);
+	this->releaseFilterCacheEntries();
+
+	for(auto fusedFilter = this->fusedFilters.begin(); fusedFilter != this->fusedFilters.end();)
+	{
+		if(std::find(fusedFilter->first.begin(), fusedFilter->first.end(), filter) != fusedFilter->first.end())
+		{
+			fusedFilter->second->release(*this);
+			fusedFilter = this->fusedFilters.erase(fusedFilter);
+		}
+		else
+			++fusedFilter;
+	}
 }
 
 
@@ -569,13 +1817,9 @@ Rml::TextureHandle RenderInterface::SaveLayerAsTexture()
 			int(this->workspace.height())
 		};
 
-	auto renderTexture = this->workspace.getRenderTexture();
+	auto renderTexture = this->getRenderTexture(dimensions);
 	Ogre::TextureGpu* texture = renderTexture.first;
-	// This looks wrong but it works?
-	// Don't want to invalidate texture pointer so don't recreate texture
-	texture->scheduleTransitionTo(Ogre::GpuResidency::OnStorage);
-	texture->setResolution(dimensions.x, dimensions.y);
-	texture->scheduleTransitionTo(Ogre::GpuResidency::Resident);
+	Ogre::Vector2 used = used_fraction(dimensions, texture);
 
 	Ogre::String id = this->workspace.getNameStr();
 	id.append("_Texture_");
@@ -584,8 +1828,11 @@ Rml::TextureHandle RenderInterface::SaveLayerAsTexture()
 		this->hlms->createDatablock(id, id, this->macroblock, this->blendblock, Ogre::HlmsParamVec()));
 	datablock->setTexture(0, texture);
 	datablock->setUseColour(true);
+	// Layer is in the top left of a possibly larger pooled texture
+	datablock->setEnableAnimationMatrix(0, true);
+	datablock->setAnimationMatrix(0, Ogre::Matrix4::getScale(used.x, used.y, 1.0f));
 
-	this->passes.push_back(RenderToTexturePass(renderTexture.second, this->renderPassSettings));
+	this->passes.push_back(RenderToTexturePass(renderTexture.second, used, this->renderPassSettings));
 
 	auto material = Material{nullptr, datablock, texture};
 	material.calculateHlmsHash();
@@ -604,19 +1851,22 @@ Rml::CompiledFilterHandle RenderInterface::SaveLayerAsMaskImage()
 			int(this->workspace.height())
 		};
 
-	auto renderTexture = this->workspace.getRenderTexture();
+	dimensions = Rml::Vector2i{
+		int(std::ceil(dimensions.x * this->maskImageScale)),
+		int(std::ceil(dimensions.y * this->maskImageScale))
+	};
+
+	auto renderTexture = this->getRenderTexture(dimensions, Ogre::PFG_R8_UNORM);
 	Ogre::TextureGpu* texture = renderTexture.first;
-	// This looks wrong but it works?
-	// Don't want to invalidate texture pointer so don't recreate texture
-	texture->scheduleTransitionTo(Ogre::GpuResidency::OnStorage);
-	texture->setResolution(dimensions.x, dimensions.y);
-	texture->scheduleTransitionTo(Ogre::GpuResidency::Resident);
+	Ogre::Vector2 used = used_fraction(dimensions, texture);
 
 	this->passes.push_back(RenderToTexturePass(
 		renderTexture.second,
-		this->renderPassSettings));
+		used,
+		this->renderPassSettings,
+		true));
 
-	auto filter = this->maskImageFilterMaker.make(texture);
+	auto filter = this->maskImageFilterMaker.make(texture, used);
 	auto handle = this->filters.insert(std::make_unique<SingleMaterialFilter>(filter));
 	return handle;
 }
@@ -630,12 +1880,20 @@ Rml::CompiledShaderHandle RenderInterface::CompileShader(
 	if(maker == this->shaderMakers.end())
 		return {};
 
-	auto shader = maker->second->make(parameters);
-	shader->setMacroblock(this->macroblock);
-	shader->setBlendblock(this->blendblock);
-	auto material = Material{shader};
-	material.calculateHlmsHash();
-	auto handle = this->shaders.insert(std::move(material));
+	Material shader = maker->second->make(parameters);
+	auto prepared = this->shaderMaterials.find(shader.material.get());
+	if(prepared == this->shaderMaterials.end())
+	{
+		shader.material->setMacroblock(this->macroblock);
+		shader.material->setBlendblock(this->blendblock);
+		shader.calculateHlmsHash();
+		prepared = this->shaderMaterials.emplace(shader.material.get(), shader).first;
+	}
+	shader.datablock = prepared->second.datablock;
+	shader.hash = prepared->second.hash;
+	shader.casterHash = prepared->second.casterHash;
+
+	auto handle = this->shaders.insert(std::move(shader));
 	return handle;
 }
 void RenderInterface::RenderShader(
@@ -644,23 +1902,30 @@ void RenderInterface::RenderShader(
 	Rml::Vector2f translation,
 	Rml::TextureHandle texture)
 {
+	auto& compiledGeometry = this->geometries.at(geometry);
+	Rml::Rectanglef bounds = this->screenBounds(compiledGeometry, translation);
+	if(!this->isVisible(bounds))
+		return;
+
 	auto& material = this->shaders.at(shader);
 	if(material.needsHashing())
 		material.calculateHlmsHash();
 
-	std::vector<QueuedGeometry>* queue = nullptr;
-	if(this->renderPassSettings.enableStencil)
-		queue = &this->getRenderPass<RenderWithStencilPass>().queue;
-	else
-		queue = &this->getRenderPass<RenderPass>().queue;
-
-	queue->push_back({
-		reinterpret_cast<Ogre::VertexArrayObject*>(geometry),
+	this->getDrawPass(bounds).queue.push_back({
+		compiledGeometry.vao,
 		translation,
-		material
+		material,
+		bounds,
+		this->drawTransform,
+		shader
 	});
 }
 void RenderInterface::ReleaseShader(Rml::CompiledShaderHandle shader)
 {
+	const Material& material = this->shaders.at(shader);
+	this->filterCache.invalidateShader(shader);
+	this->releaseFilterCacheEntries();
+	for(auto& maker : this->shaderMakers)
+		maker.second->release(material);
 	this->shaders.erase(shader);
 }
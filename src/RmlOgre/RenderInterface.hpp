@@ -1,18 +1,35 @@
 #ifndef NIMBLE_RMLOGRE_RENDERINTERFACE_HPP
 #define NIMBLE_RMLOGRE_RENDERINTERFACE_HPP
 
+#include "FilterCache.hpp"
 #include "FilterMaker.hpp"
+#include "GradientAtlas.hpp"
 #include "Material.hpp"
+#include "MaterialCache.hpp"
 #include "ObjectIndex.hpp"
+#include "RoundedClipListener.hpp"
 #include "ShaderMaker.hpp"
+#include "TextureAtlas.hpp"
 #include "Workspace.hpp"
 #include "filters.hpp"
+#include "geometry.hpp"
 
 #include <OgreHlmsDatablock.h>
 #include <OgreHlmsSamplerblock.h>
 
 #include <RmlUi/Core/RenderInterface.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 
 namespace Ogre {
 
@@ -42,22 +59,166 @@ struct Layer
 	}
 };
 
+struct ClipMaskStats
+{
+	// Clip mask operations with rectangles, clipped to with the scissor region
+	std::size_t scissorClips = 0;
+	// Clip mask operations rendered to the stencil
+	std::size_t stencilClips = 0;
+	// Clip mask operations not rendered, as nothing drawn could be clipped by them
+	std::size_t skippedStencilClips = 0;
+	// Clip mask operations not rendered, as the stencil already held them
+	std::size_t reusedStencilClips = 0;
+	// Draws inside convex clip masks, drawn without testing the stencil
+	std::size_t unclippedDraws = 0;
+	// Clip mask operations with rounded rectangles, clipped to in the pixel shader
+	std::size_t shaderClips = 0;
+};
+
+struct TextureLoadStats
+{
+	std::size_t loads = 0;
+	// Loads with dimensions from the metadata cache, which don't wait for the texture
+	std::size_t metadataCacheHits = 0;
+	// Loads that blocked waiting for the texture's metadata
+	std::size_t blockingWaits = 0;
+	// Loads generating mipmaps in the background
+	std::size_t mipmappedLoads = 0;
+};
+
+struct TextureMemoryStats
+{
+	// Bytes of loaded textures allowed to stay resident
+	std::size_t budget = std::numeric_limits<std::size_t>::max();
+	std::size_t residentBytes = 0;
+	std::size_t evictions = 0;
+	// Evicted textures made resident again when drawn
+	std::size_t reloads = 0;
+};
+
 class RenderInterface : public Rml::RenderInterface
 {
+public:
+	static constexpr std::uint32_t DEFAULT_TEXTURE_EVICTION_FRAMES = 60;
+
+private:
 	Ogre::HlmsUnlit* hlms = nullptr;
+	// Null if rounded clips can't be clipped to in the pixel shader
+	std::shared_ptr<RoundedClipListener> roundedClipListener;
 	Ogre::HlmsMacroblock macroblock;
 	Ogre::HlmsBlendblock blendblock;
 	Ogre::HlmsSamplerblock samplerblock;
+	ObjectIndex<Geometry> geometries;
 	ObjectIndex<Material> materials;
-
+	struct LoadedTexture
+	{
+		Rml::TextureHandle handle;
+		Rml::Vector2i dimensions;
+		int references = 0;
+		Ogre::TextureGpu* texture = nullptr;
+	};
+	// Textures loaded from files, shared by loads of the same source
+	std::unordered_map<Rml::String, LoadedTexture> loadedTextures;
+	std::unordered_map<Rml::TextureHandle, Rml::String> loadedTextureSources;
+	// Dimensions of textures by source, so loading them doesn't wait for their metadata
+	std::unordered_map<Rml::String, Rml::Vector2i> textureMetadata;
+	// Textures loaded with cached dimensions, to update the cache once their metadata is ready
+	std::vector<std::pair<Rml::String, Ogre::TextureGpu*>> pendingTextureMetadata;
+	TextureLoadStats textureLoadStats;
+	std::uint32_t textureMipmapThreshold = 0;
+	// Loaded textures unused for textureEvictionFrames are paged out, least
+	// recently used first, while their total size is over the budget
+	std::uint64_t frame = 0;
+	std::vector<std::uint64_t> textureLastUsed;
+	std::unordered_set<Rml::TextureHandle> evictedTextures;
+	std::uint32_t textureEvictionFrames = DEFAULT_TEXTURE_EVICTION_FRAMES;
+	TextureMemoryStats textureMemoryStats;
+	// Layer opacities folded into draws are rounded to this many steps, so fading
+	// layers share copies of datablocks
+	static constexpr int OPACITY_STEPS = 64;
+	static constexpr std::uint32_t OPACITY_MATERIAL_EVICTION_FRAMES = 60;
+	// Free render textures are shrunk once unused for this many frames
+	static constexpr std::uint32_t RENDER_TEXTURE_SHRINK_FRAMES = 60;
+	struct OpacityMaterial
+	{
+		Material material;
+		std::uint64_t lastUsed = 0;
+	};
+	// Copies of texture datablocks with their colour set to an opacity,
+	// destroyed once unused for OPACITY_MATERIAL_EVICTION_FRAMES
+	std::map<std::pair<Ogre::HlmsDatablock*, Ogre::uint8>, OpacityMaterial> opacityMaterials;
+
+	MaterialCache materialCache;
 	std::unordered_map<Rml::String, std::unique_ptr<FilterMaker>> filterMakers;
 	MaskImageFilterMaker maskImageFilterMaker;
+	// Mask images are saved with alpha alone, scaled by this
+	float maskImageScale = 1.0f;
+	ColourMatrixFilterMaker colourMatrixFilterMaker;
 	ObjectIndex<std::unique_ptr<Filter>> filters;
-
+	// Products of consecutive colour matrix filters, keyed by their handles
+	std::map<std::vector<Rml::CompiledFilterHandle>, std::unique_ptr<Filter>> fusedFilters;
+	FilterCache filterCache;
+	Ogre::MaterialPtr cachedLayerMaterial;
+
+	GradientAtlas gradientAtlas;
+	// Small loaded images packed into shared textures, by the handles drawing them
+	TextureAtlas textureAtlas;
+	std::unordered_map<Rml::TextureHandle, TextureAtlas::Region> atlasRegions;
+	// Sources drawn with wrapping texture coordinates, which aren't packed again
+	std::unordered_set<Rml::String> unpackedSources;
+	std::uint32_t textureAtlasThreshold = 0;
 	std::unordered_map<Rml::String, std::unique_ptr<ShaderMaker>> shaderMakers;
 	ObjectIndex<Material> shaders;
+	// Hashed shader materials, shared by shaders with different custom parameters
+	std::unordered_map<const Ogre::Material*, Material> shaderMaterials;
 
 	RenderPassSettings renderPassSettings;
+	// Scissor region and clip mask as set through Rml, combined into renderPassSettings
+	bool enableScissor = false;
+	Rml::Rectanglei scissorRegion;
+	bool enableClipMask = false;
+	// Clip mask is this region, when valid, intersected with the stencil clips
+	Rml::Rectanglei clipMaskRegion = Rml::Rectanglei::MakeInvalid();
+	struct StencilClip
+	{
+		Rml::ClipMaskOperation operation;
+		Rml::CompiledGeometryHandle geometry;
+		Rml::Vector2f translation;
+		RenderPassSettings settings;
+		Ogre::Matrix4 drawTransform;
+
+		bool operator==(const StencilClip& b) const
+		{
+			return this->operation == b.operation
+				&& this->geometry == b.geometry
+				&& this->translation == b.translation
+				&& this->settings == b.settings
+				&& this->drawTransform == b.drawTransform;
+		}
+	};
+	// Clip mask operations since the last Set, only rendered to the stencil
+	// once something that may be clipped by them is drawn
+	std::vector<StencilClip> stencilClips;
+	std::size_t writtenStencilClips = 0;
+	// Clips last rendered to the stencil this frame
+	std::vector<StencilClip> stencilContents;
+	// Screen space hulls of the stencil clips when they're all convex, draws
+	// inside all of them aren't clipped
+	std::vector<std::vector<Rml::Vector2f>> stencilClipHulls;
+	bool stencilClipsConvex = false;
+	struct RoundedClip
+	{
+		// Centre and half size, then radii, in screen pixels
+		Ogre::Vector4 rect;
+		Ogre::Vector4 radii;
+		bool used = false;
+	};
+	// Stencil clip when it's a lone rounded rectangle, Hlms materials are
+	// clipped to it in the pixel shader instead
+	std::optional<RoundedClip> roundedClip;
+	ClipMaskStats clipMaskStats;
+	// Part of the current transform set on each draw instead of its pass
+	Ogre::Matrix4 drawTransform = Ogre::Matrix4::IDENTITY;
 	int connectionId = 0;
 	std::vector<Layer> layerBuffers;
 	int numActiveLayers = 0;
@@ -66,23 +227,93 @@ class RenderInterface : public Rml::RenderInterface
 	int datablockId = 0;
 	std::vector<Rml::CompiledGeometryHandle> releaseGeometries;
 	std::vector<Rml::TextureHandle> releaseTextures;
+	std::vector<Ogre::HlmsDatablock*> releaseDatablocks;
 	std::vector<Ogre::TextureGpu*> releaseRenderTextures;
 
 	Workspace workspace;
 
 	void releaseBufferedGeometries();
+	void updateTextureMetadata();
+	// Null if the image isn't small enough to be packed into the texture atlas
+	Rml::TextureHandle loadAtlasTexture(Rml::Vector2i& texture_dimensions, const Rml::String& source);
+	// Replaces a packed image's texture with its own, streamed from its source
+	void unpackAtlasTexture(Rml::TextureHandle handle);
+	Ogre::TextureGpu* streamTexture(const Rml::String& source);
+	void useTexture(Rml::TextureHandle texture);
+	void evictTextures();
+	void evictOpacityMaterials();
+	// Along with its opacity copies
+	void destroyTextureDatablock(Ogre::HlmsDatablock* datablock);
 	void releaseBufferedTextures();
 
+	Rml::Rectanglef screenBounds(const Geometry& geometry, Rml::Vector2f translation) const;
+	Rml::Rectanglef clipRegion(const RenderPassSettings& settings) const;
+	bool isVisible(const Rml::Rectanglef& bounds) const;
+	// Pixels covered by geometry that's an axis aligned rectangle on screen
+	bool screenRectangle(const Geometry& geometry, Rml::Vector2f translation, Rml::Rectanglei& region) const;
+	bool screenHull(const std::vector<Rml::Vector2f>& convexHull, Rml::Vector2f translation, std::vector<Rml::Vector2f>& hull) const;
+	// Geometry that's a rounded rectangle on screen, translated and uniformly scaled
+	bool screenRoundedRectangle(Geometry& geometry, Rml::Vector2f translation, RoundedClip& clip) const;
+	void updateClipping();
+	void clearStencilClips();
+	void writeStencilClips();
+	enum class DrawClip
+	{
+		NONE,
+		SHADER,
+		STENCIL
+	};
+	// How something drawn inside bounds must be clipped to the stencil clips, renders
+	// them if it's by the stencil. Null bounds are treated as unbounded. With shaderClip,
+	// the draw can be clipped to a rounded rectangle in the pixel shader.
+	DrawClip clipDraw(const Rml::Rectanglef* bounds, bool shaderClip = false);
+	// Pass for a draw, tested against the stencil only if it may be clipped by it
+	BaseRenderPass& getDrawPass(const Rml::Rectanglef& bounds, bool shaderClip = false);
+
+	const Material& getOpacityMaterial(const Material& material, Ogre::uint8 alpha);
+	bool foldLayerOpacity(float opacity);
+	// Leaves the last filter to the returned composite material when possible, unless applyAll
+	Ogre::MaterialPtr applyFilters(
+		Rml::Span<const Rml::CompiledFilterHandle> filters,
+		bool noBlending,
+		bool applyAll = false);
+
+	bool isFilterCacheable(Rml::Span<const Rml::CompiledFilterHandle> filters);
+	// Appends the top layer's draws to key and what they were drawn with to resources
+	// and shaders, returns the index of its first draw pass
+	// or 0 if its content can't be cached
+	std::size_t describeLayerContent(
+		std::string& key,
+		std::vector<const void*>& resources,
+		std::vector<Rml::CompiledShaderHandle>& shaders) const;
+	Ogre::MaterialPtr getCachedLayerMaterial(
+		FilterCache::Entry& entry,
+		const Rml::Rectanglei& region,
+		bool noBlending);
+	void releaseFilterCacheEntries();
+
+	// Render texture resized to dimensions, and its external texture index
+	std::pair<Ogre::TextureGpu*, std::size_t> getRenderTexture(
+		Rml::Vector2i dimensions,
+		Ogre::PixelFormatGpu pixelFormat = Ogre::PFG_RGBA8_UNORM_SRGB);
+
+	// Whether a draw with screen bounds can be added to the pass, true for
+	// different scissor regions when neither clips the draw. When no draw
+	// of the pass is clipped by its own scissor region, the pass's scissor
+	// region is widened to include the draw's.
+	bool joinPass(BaseRenderPass& pass, const Rml::Rectanglef* bounds) const;
+	void startPass(BaseRenderPass& pass, const Rml::Rectanglef* bounds) const;
+
 	template <class TRenderPass>
-	TRenderPass& getRenderPass()
+	TRenderPass& getRenderPass(const Rml::Rectanglef* bounds = nullptr)
 	{
 		TRenderPass* lastPass = nullptr;
 		if(!this->passes.empty())
 			lastPass = std::get_if<TRenderPass>(&this->passes.back());
-		if(!lastPass || lastPass->settings != this->renderPassSettings)
+		if(!lastPass || !this->joinPass(*lastPass, bounds))
 		{
 			TRenderPass newPass;
-			newPass.settings = this->renderPassSettings;
+			this->startPass(newPass, bounds);
 			this->passes.push_back(std::move(newPass));
 			lastPass = &std::get<TRenderPass>(this->passes.back());
 		}
@@ -105,18 +336,56 @@ public:
 	void releaseLayerBuffer(Layer id);
 
 	const RenderPassSettings& currentRenderPassSettings() const { return this->renderPassSettings; }
+	MaterialCache& getMaterialCache() { return this->materialCache; }
+	Rml::Vector2i currentOutputSize() const
+	{
+		return Rml::Vector2i{int(this->workspace.width()), int(this->workspace.height())};
+	}
 	void addPass(Pass&& pass);
 	void releaseRenderTexture(Ogre::TextureGpu* texture);
 
 
 	void AddFilterMaker(Rml::String name, std::unique_ptr<FilterMaker> filterMaker);
 	void AddShaderMaker(Rml::String name, std::unique_ptr<ShaderMaker> shaderMaker);
+	// Settings of the blur and drop-shadow filter makers, used by filters compiled afterwards
+	void SetBlurSettings(const BlurSettings& settings);
 
 	Ogre::TextureGpu* GetOutput() const       { return this->workspace.output(); }
 	void SetOutput(Ogre::TextureGpu* texture) { this->workspace.output(texture); }
 	Ogre::TextureGpu* GetBackground() const       { return this->workspace.background(); }
 	void SetBackground(Ogre::TextureGpu* texture) { this->workspace.background(texture); }
 
+	const MaterialCache::Stats& GetFilterMaterialStats() const { return this->materialCache.getStats(); }
+	const FilterCache::Stats& GetFilterCacheStats() const { return this->filterCache.getStats(); }
+	const ClipMaskStats& GetClipMaskStats() const { return this->clipMaskStats; }
+	const TextureLoadStats& GetTextureLoadStats() const { return this->textureLoadStats; }
+	const TextureMemoryStats& GetTextureMemoryStats() const { return this->textureMemoryStats; }
+	const RenderTexturePool::Stats& GetRenderTextureStats() const { return this->workspace.renderTextureStats(); }
+	// Memory budget of cached filter outputs in bytes, 0 disables caching
+	void SetFilterCacheBudget(std::size_t budget) { this->filterCache.setBudget(budget); }
+
+	// Texture dimensions by source as lines of "<width> <height> <source>", to
+	// be saved and imported on the next run so loading textures doesn't block
+	Rml::String ExportTextureMetadata() const;
+	void ImportTextureMetadata(const Rml::String& metadata);
+
+	// Textures loaded from files are paged out when unused for frames while
+	// over budget bytes, and loaded again when next drawn. Generated textures
+	// can't be loaded again, so they're never paged out.
+	void SetTextureMemoryBudget(std::size_t budget) { this->textureMemoryStats.budget = budget; }
+	void SetTextureEvictionFrames(std::uint32_t frames) { this->textureEvictionFrames = frames; }
+	// Images loaded after this with either dimension over size have mipmaps
+	// generated when loaded in the background, 0 disables. Images without
+	// cached dimensions get mipmaps too, as their size isn't known until loaded.
+	// Images with their own mipmaps, like DDS and KTX files, always keep them.
+	void SetTextureMipmapThreshold(std::uint32_t size) { this->textureMipmapThreshold = size; }
+	// Images loaded after this with neither dimension over size are packed into
+	// shared textures, 0 disables. Only images with cached dimensions (see
+	// ImportTextureMetadata) are packed. Packed images can't be drawn repeating.
+	void SetTextureAtlasThreshold(std::uint32_t size) { this->textureAtlasThreshold = size; }
+	// Resolution of mask images saved after this, between 0.5 and 1. Masks are sampled bilinearly.
+	void SetMaskImageScale(float scale) { this->maskImageScale = std::clamp(scale, 0.5f, 1.0f); }
+
 
 	void BeginFrame();
 	void EndFrame();
@@ -141,6 +410,12 @@ public:
 		Rml::Vector2i source_dimensions
 	) override;
 	void ReleaseTexture(Rml::TextureHandle texture) override;
+	// Replaces the texels of region in a generated texture with source, as in
+	// GenerateTexture. False if texture wasn't generated or region is outside it.
+	bool UpdateTexture(
+		Rml::TextureHandle texture,
+		Rml::Rectanglei region,
+		Rml::Span<const Rml::byte> source);
 
 	void EnableScissorRegion(bool enable) override;
 	void SetScissorRegion(Rml::Rectanglei region) override;
@@ -63,4 +63,7 @@ void RenderObject::setPreparedMaterial(const Material& material)
 		this->_setHlmsHashes(material.hash, material.casterHash);
 		mHlmsDatablock->_linkRenderable(this);
 	}
+
+	for(Ogre::uint8 i = 0; i < material.numCustomParameters; ++i)
+		this->setCustomParameter(i, material.customParameters[i]);
 }
@@ -0,0 +1,163 @@
+#include "RenderTexturePool.hpp"
+
+#include <OgrePixelFormatGpuUtils.h>
+#include <OgreTextureGpu.h>
+
+#include <algorithm>
+#include <cassert>
+
+
+using namespace nimble::RmlOgre;
+
+std::pair<Ogre::TextureGpu*, std::size_t> RenderTexturePool::claimSlot(std::size_t i)
+{
+	this->slots[i].used = true;
+	++this->stats.used;
+	return {this->textures[i], i};
+}
+
+void RenderTexturePool::removeUnused(std::size_t i)
+{
+	auto bucket = this->unused.find(this->slots[i].format);
+	assert(bucket != this->unused.end());
+	auto& indices = bucket->second;
+	indices.erase(std::find(indices.begin(), indices.end(), i));
+	if(indices.empty())
+		this->unused.erase(bucket);
+}
+
+void RenderTexturePool::resize(std::size_t i, const Format& format)
+{
+	Ogre::TextureGpu* texture = this->textures[i];
+	this->stats.bytes -= texture->getSizeBytes();
+	// Don't want to invalidate texture pointer so don't recreate texture
+	texture->scheduleTransitionTo(Ogre::GpuResidency::OnStorage);
+	texture->setResolution(format.width, format.height);
+	texture->setPixelFormat(format.pixelFormat);
+	texture->setNumMipmaps(format.mipmaps
+		? Ogre::PixelFormatGpuUtils::getMaxMipmapCount(format.width, format.height)
+		: 1u);
+	texture->scheduleTransitionTo(Ogre::GpuResidency::Resident);
+	this->stats.bytes += texture->getSizeBytes();
+	this->slots[i].format = format;
+}
+
+RenderTexturePool::Format RenderTexturePool::sizeClass(const Format& format)
+{
+	auto round = [](Ogre::uint32 size) {
+		return std::max((size + SIZE_CLASS - 1) / SIZE_CLASS, 1u) * SIZE_CLASS;
+	};
+	Format rounded = format;
+	rounded.width = round(format.width);
+	rounded.height = round(format.height);
+	return rounded;
+}
+
+std::pair<Ogre::TextureGpu*, std::size_t> RenderTexturePool::add(Ogre::TextureGpu* texture, bool claimed)
+{
+	Slot slot;
+	slot.format = Format{
+		texture->getWidth(),
+		texture->getHeight(),
+		texture->getPixelFormat(),
+		texture->getNumMipmaps() > 1
+	};
+	slot.freedFrame = this->frame;
+
+	std::size_t i = this->textures.size();
+	this->textures.push_back(texture);
+	this->slots.push_back(slot);
+	this->indices.emplace(texture, i);
+
+	++this->stats.creations;
+	this->stats.textures = this->textures.size();
+	this->stats.bytes += texture->getSizeBytes();
+
+	if(claimed)
+		return this->claimSlot(i);
+
+	this->unused[slot.format].push_back(i);
+	return {texture, i};
+}
+
+std::optional<std::pair<Ogre::TextureGpu*, std::size_t>> RenderTexturePool::claim(const Format& format)
+{
+	++this->stats.claims;
+
+	auto bucket = this->unused.find(format);
+	if(bucket != this->unused.end())
+	{
+		// Most recently freed, the bucket's other textures are more likely to be resized
+		std::size_t i = bucket->second.back();
+		bucket->second.pop_back();
+		if(bucket->second.empty())
+			this->unused.erase(bucket);
+
+		++this->stats.reuses;
+		return this->claimSlot(i);
+	}
+
+	std::optional<std::size_t> oldest;
+	for(auto& unusedBucket : this->unused)
+	{
+		if(unusedBucket.first.mipmaps != format.mipmaps)
+			continue;
+		for(std::size_t i : unusedBucket.second)
+			if(!oldest || this->slots[i].freed < this->slots[*oldest].freed)
+				oldest = i;
+	}
+	if(!oldest)
+		return {};
+
+	std::size_t i = *oldest;
+	this->removeUnused(i);
+	this->resize(i, format);
+
+	++this->stats.resizes;
+	return this->claimSlot(i);
+}
+
+bool RenderTexturePool::free(Ogre::TextureGpu* texture)
+{
+	auto index = this->indices.find(texture);
+	if(index == this->indices.end())
+		return false;
+
+	Slot& slot = this->slots[index->second];
+	if(!slot.used)
+		return true;
+
+	slot.used = false;
+	slot.freed = ++this->numFreed;
+	slot.freedFrame = this->frame;
+	this->unused[slot.format].push_back(index->second);
+	--this->stats.used;
+
+	return true;
+}
+
+void RenderTexturePool::beginFrame(std::uint64_t unusedFrames)
+{
+	++this->frame;
+
+	std::vector<std::size_t> shrink;
+	for(auto& bucket : this->unused)
+	{
+		if(bucket.first.width == 1 && bucket.first.height == 1)
+			continue;
+		for(std::size_t i : bucket.second)
+			if(this->frame - this->slots[i].freedFrame > unusedFrames)
+				shrink.push_back(i);
+	}
+
+	for(std::size_t i : shrink)
+	{
+		Format format = this->slots[i].format;
+		format.width = 1;
+		format.height = 1;
+		this->removeUnused(i);
+		this->resize(i, format);
+		this->unused[format].push_back(i);
+		++this->stats.shrinks;
+	}
+}
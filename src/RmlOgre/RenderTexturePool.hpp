@@ -0,0 +1,123 @@
+#ifndef NIMBLE_RMLOGRE_RENDERTEXTUREPOOL_HPP
+#define NIMBLE_RMLOGRE_RENDERTEXTUREPOOL_HPP
+
+#include <OgrePixelFormatGpu.h>
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace Ogre {
+
+class TextureGpu;
+
+}
+
+namespace nimble::RmlOgre {
+
+// Render textures bucketed by size and format. Claims reuse a free texture
+// already of the requested size and format without any residency transition,
+// only resizing a free texture of another bucket when the bucket is empty.
+// Sizes are rounded up to size classes, so claimed textures can be larger than
+// requested, with the rest left unused.
+class RenderTexturePool
+{
+public:
+	static constexpr Ogre::uint32 SIZE_CLASS = 64;
+
+	struct Format
+	{
+		Ogre::uint32 width = 1;
+		Ogre::uint32 height = 1;
+		Ogre::PixelFormatGpu pixelFormat = Ogre::PFG_RGBA8_UNORM_SRGB;
+		// Needs to be known when creating the texture, so textures are
+		// only resized between formats with the same mipmaps setting
+		bool mipmaps = false;
+
+		bool operator<(const Format& b) const
+		{
+			return std::tie(this->width, this->height, this->pixelFormat, this->mipmaps)
+				< std::tie(b.width, b.height, b.pixelFormat, b.mipmaps);
+		}
+		bool operator==(const Format& b) const
+		{
+			return std::tie(this->width, this->height, this->pixelFormat, this->mipmaps)
+				== std::tie(b.width, b.height, b.pixelFormat, b.mipmaps);
+		}
+	};
+
+	struct Stats
+	{
+		std::size_t textures = 0;
+		std::size_t used = 0;
+		std::size_t claims = 0;
+		// Claims given a free texture already of the requested format
+		std::size_t reuses = 0;
+		// Claims given a free texture of another format, resized
+		std::size_t resizes = 0;
+		std::size_t creations = 0;
+		// Free textures resized down after going unused
+		std::size_t shrinks = 0;
+		// Of used and free textures, base levels only
+		std::size_t bytes = 0;
+	};
+
+private:
+	struct Slot
+	{
+		Format format;
+		bool used = false;
+		// Order freed, textures freed longest ago are resized first
+		std::uint64_t freed = 0;
+		std::uint64_t freedFrame = 0;
+	};
+
+	std::vector<Ogre::TextureGpu*> textures;
+	std::vector<Slot> slots;
+	std::unordered_map<Ogre::TextureGpu*, std::size_t> indices;
+	std::map<Format, std::vector<std::size_t>> unused;
+	std::uint64_t numFreed = 0;
+	std::uint64_t frame = 0;
+	Stats stats;
+
+	std::pair<Ogre::TextureGpu*, std::size_t> claimSlot(std::size_t i);
+	void removeUnused(std::size_t i);
+	void resize(std::size_t i, const Format& format);
+
+public:
+	using Iterator = std::vector<Ogre::TextureGpu*>::iterator;
+	using ConstIterator = std::vector<Ogre::TextureGpu*>::const_iterator;
+
+	std::size_t size() const { return this->textures.size(); }
+	Iterator begin() { return this->textures.begin(); }
+	Iterator end() { return this->textures.end(); }
+	ConstIterator begin() const { return this->textures.begin(); }
+	ConstIterator end() const { return this->textures.end(); }
+
+	// Format is taken from the texture's resolution, pixel format and mipmaps.
+	// Claimed textures complete a claim that was empty.
+	std::pair<Ogre::TextureGpu*, std::size_t> add(Ogre::TextureGpu* texture, bool claimed = false);
+
+	// Format with its size rounded up to its size class
+	static Format sizeClass(const Format& format);
+
+	// Texture and its index, empty if no free texture can be resized to the format.
+	// Format should already be rounded to its size class.
+	std::optional<std::pair<Ogre::TextureGpu*, std::size_t>> claim(const Format& format);
+	bool free(Ogre::TextureGpu* texture);
+
+	// Shrinks textures free for more than unusedFrames frames to 1x1,
+	// keeping their pixel format and mipmaps setting
+	void beginFrame(std::uint64_t unusedFrames);
+
+	const Stats& getStats() const { return this->stats; }
+};
+
+}
+
+#endif // NIMBLE_RMLOGRE_RENDERTEXTUREPOOL_HPP
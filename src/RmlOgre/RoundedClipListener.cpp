@@ -0,0 +1,130 @@
+#include "RoundedClipListener.hpp"
+
+#include "Compositor/CompositorPassGeometry.hpp"
+
+#include <OgreArchive.h>
+#include <OgreHlms.h>
+#include <OgreLogManager.h>
+#include <OgreRenderPassDescriptor.h>
+#include <OgreRenderSystem.h>
+#include <OgreSceneManager.h>
+
+#include <algorithm>
+#include <map>
+
+
+using namespace nimble::RmlOgre;
+
+namespace {
+
+const Ogre::IdString ROUNDED_CLIP_PROPERTY("rml_rounded_clip");
+const Ogre::String ROUNDED_CLIP_PIECES("RmlOgreRoundedClip_piece_all.any");
+// Must match custom_passBuffer in media/Hlms/Unlit/Any/RmlOgreRoundedClip_piece_all.any
+constexpr Ogre::uint32 ROUNDED_CLIP_FLOATS = 3 * 4;
+
+// Geometry pass being rendered, if it's clipped to a rounded rectangle
+const CompositorPassGeometry* rounded_clip_pass(Ogre::SceneManager* sceneManager, bool casterPass)
+{
+	if(casterPass)
+		return nullptr;
+	auto* pass = dynamic_cast<const CompositorPassGeometry*>(sceneManager->getCurrentCompositorPass());
+	return pass && pass->enableRoundedClip ? pass : nullptr;
+}
+
+bool has_pieces(Ogre::Hlms* hlms)
+{
+	for(Ogre::Archive* archive : hlms->getPiecesLibraryAsArchiveVec())
+		if(archive->exists(ROUNDED_CLIP_PIECES))
+			return true;
+	return false;
+}
+
+}
+
+std::shared_ptr<RoundedClipListener> RoundedClipListener::acquire(Ogre::Hlms* hlms)
+{
+	static std::map<Ogre::Hlms*, std::weak_ptr<RoundedClipListener>> listeners;
+
+	std::weak_ptr<RoundedClipListener>& listener = listeners[hlms];
+	if(auto shared = listener.lock())
+		return shared;
+
+	if(!has_pieces(hlms))
+	{
+		Ogre::LogManager::getSingleton().logMessage(
+			"RmlOgre: " + ROUNDED_CLIP_PIECES + " isn't in the " + hlms->getTypeNameStr()
+				+ " Hlms library, rounded clip masks will be clipped by the stencil",
+			Ogre::LML_CRITICAL);
+		return nullptr;
+	}
+
+	auto shared = std::make_shared<RoundedClipListener>(hlms);
+	listener = shared;
+	return shared;
+}
+
+RoundedClipListener::RoundedClipListener(Ogre::Hlms* hlms) :
+	hlms{hlms},
+	next{hlms->getListener()}
+{
+	this->hlms->setListener(this);
+}
+RoundedClipListener::~RoundedClipListener()
+{
+	if(this->hlms->getListener() == this)
+		this->hlms->setListener(this->next);
+}
+
+void RoundedClipListener::preparePassHash(
+	const Ogre::CompositorShadowNode* shadowNode,
+	bool casterPass,
+	bool dualParaboloid,
+	Ogre::SceneManager* sceneManager,
+	Ogre::Hlms* hlms)
+{
+	this->next->preparePassHash(shadowNode, casterPass, dualParaboloid, sceneManager, hlms);
+	if(!rounded_clip_pass(sceneManager, casterPass))
+		return;
+
+#if OGRE_VERSION_MAJOR >= 3
+	hlms->_setProperty(Ogre::kNoTid, ROUNDED_CLIP_PROPERTY, 1);
+#else
+	hlms->_setProperty(ROUNDED_CLIP_PROPERTY, 1);
+#endif
+}
+
+Ogre::uint32 RoundedClipListener::getPassBufferSize(
+	const Ogre::CompositorShadowNode* shadowNode,
+	bool casterPass,
+	bool dualParaboloid,
+	Ogre::SceneManager* sceneManager) const
+{
+	Ogre::uint32 size = this->next->getPassBufferSize(shadowNode, casterPass, dualParaboloid, sceneManager);
+	if(rounded_clip_pass(sceneManager, casterPass))
+		size += ROUNDED_CLIP_FLOATS * sizeof(float);
+	return size;
+}
+
+float* RoundedClipListener::preparePassBuffer(
+	const Ogre::CompositorShadowNode* shadowNode,
+	bool casterPass,
+	bool dualParaboloid,
+	Ogre::SceneManager* sceneManager,
+	float* passBufferPtr)
+{
+	passBufferPtr = this->next->preparePassBuffer(
+		shadowNode, casterPass, dualParaboloid, sceneManager, passBufferPtr);
+	const CompositorPassGeometry* pass = rounded_clip_pass(sceneManager, casterPass);
+	if(!pass)
+		return passBufferPtr;
+
+	Ogre::Vector4 ndcToScreen = pass->ndcToScreen;
+	// Hlms negates y of the projection for these targets
+	if(sceneManager->getDestinationRenderSystem()->getCurrentPassDescriptor()->requiresTextureFlipping())
+		ndcToScreen.y = -ndcToScreen.y;
+
+	passBufferPtr = std::copy_n(pass->roundedClipRect.ptr(), 4, passBufferPtr);
+	passBufferPtr = std::copy_n(pass->roundedClipRadii.ptr(), 4, passBufferPtr);
+	passBufferPtr = std::copy_n(ndcToScreen.ptr(), 4, passBufferPtr);
+	return passBufferPtr;
+}
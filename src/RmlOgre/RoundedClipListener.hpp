@@ -0,0 +1,52 @@
+#ifndef NIMBLE_RMLOGRE_ROUNDEDCLIPLISTENER_HPP
+#define NIMBLE_RMLOGRE_ROUNDEDCLIPLISTENER_HPP
+
+#include <OgreHlmsListener.h>
+
+#include <memory>
+
+
+namespace nimble::RmlOgre {
+
+// Adds the rounded clip of the geometry pass being rendered to the Hlms's pass
+// buffer, for media/Hlms/Unlit/Any/RmlOgreRoundedClip_piece_all.any. Pass hash
+// and buffer calls are forwarded to the Hlms's previous listener.
+//
+// One listener is shared by everything rendering with an Hlms, see acquire.
+class RoundedClipListener : public Ogre::HlmsListener
+{
+	Ogre::Hlms* hlms = nullptr;
+	Ogre::HlmsListener* next = nullptr;
+
+public:
+	// Listener for the Hlms, set as its listener while any are held. Null, with a
+	// warning logged, if the pieces aren't in the Hlms's library.
+	static std::shared_ptr<RoundedClipListener> acquire(Ogre::Hlms* hlms);
+
+	RoundedClipListener(Ogre::Hlms* hlms);
+	~RoundedClipListener();
+	RoundedClipListener(const RoundedClipListener&) = delete;
+	RoundedClipListener& operator=(const RoundedClipListener&) = delete;
+
+	void preparePassHash(
+		const Ogre::CompositorShadowNode* shadowNode,
+		bool casterPass,
+		bool dualParaboloid,
+		Ogre::SceneManager* sceneManager,
+		Ogre::Hlms* hlms) override;
+	Ogre::uint32 getPassBufferSize(
+		const Ogre::CompositorShadowNode* shadowNode,
+		bool casterPass,
+		bool dualParaboloid,
+		Ogre::SceneManager* sceneManager) const override;
+	float* preparePassBuffer(
+		const Ogre::CompositorShadowNode* shadowNode,
+		bool casterPass,
+		bool dualParaboloid,
+		Ogre::SceneManager* sceneManager,
+		float* passBufferPtr) override;
+};
+
+}
+
+#endif // NIMBLE_RMLOGRE_ROUNDEDCLIPLISTENER_HPP
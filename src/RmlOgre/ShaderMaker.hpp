@@ -1,7 +1,7 @@
 #ifndef NIMBLE_RMLOGRE_SHADERMAKER_HPP
 #define NIMBLE_RMLOGRE_SHADERMAKER_HPP
 
-#include <OgreMaterial.h>
+#include "Material.hpp"
 
 #include <RmlUi/Core/Dictionary.h>
 
@@ -12,7 +12,10 @@ class ShaderMaker
 {
 public:
 	virtual ~ShaderMaker() {}
-	virtual Ogre::MaterialPtr make(const Rml::Dictionary& parameters) = 0;
+	// Material may be shared between shaders, with their own custom parameters
+	virtual Material make(const Rml::Dictionary& parameters) = 0;
+	// Called for every released shader, including those made by other makers
+	virtual void release(const Material& shader) {}
 };
 
 }
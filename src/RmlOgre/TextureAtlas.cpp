@@ -0,0 +1,203 @@
+#include "TextureAtlas.hpp"
+
+#include <OgreRoot.h>
+#include <OgreStagingTexture.h>
+#include <OgreTextureBox.h>
+#include <OgreTextureGpu.h>
+#include <OgreTextureGpuManager.h>
+
+#include <algorithm>
+#include <cassert>
+
+
+using namespace nimble::RmlOgre;
+
+Ogre::Matrix4 TextureAtlas::Region::uvTransform() const
+{
+	float size = PAGE_SIZE;
+	// Applied to (u, v, 0, 1), so the offset goes in the translation column
+	return Ogre::Matrix4(
+		this->width / size, 0.0f,                0.0f, this->x / size,
+		0.0f,               this->height / size, 0.0f, this->y / size,
+		0.0f,               0.0f,                1.0f, 0.0f,
+		0.0f,               0.0f,                0.0f, 1.0f);
+}
+
+TextureAtlas::TextureAtlas(Ogre::String name) :
+	name{std::move(name)}
+{}
+TextureAtlas::~TextureAtlas()
+{
+	if(this->pages.empty())
+		return;
+
+	Ogre::TextureGpuManager* textureManager = Ogre::Root::getSingleton()
+		.getRenderSystem()
+		->getTextureGpuManager();
+	for(auto& page : this->pages)
+		textureManager->destroyTexture(page.texture);
+}
+
+TextureAtlas::Page& TextureAtlas::addPage()
+{
+	Ogre::String id = this->name;
+	id.append("_TextureAtlas_");
+	id.append(std::to_string(this->pages.size()));
+
+	Page page;
+	page.texture = Ogre::Root::getSingleton()
+		.getRenderSystem()
+		->getTextureGpuManager()
+		->createTexture(
+			id,
+			Ogre::GpuPageOutStrategy::Discard,
+			Ogre::TextureFlags::ManualTexture | Ogre::TextureFlags::AutomaticBatching,
+			Ogre::TextureTypes::Type2D);
+	page.texture->setPixelFormat(Ogre::PixelFormatGpu::PFG_RGBA8_UNORM);
+	page.texture->setResolution(PAGE_SIZE, PAGE_SIZE);
+	page.texture->setNumMipmaps(1);
+	page.texture->scheduleTransitionTo(Ogre::GpuResidency::Resident);
+
+	this->pages.push_back(std::move(page));
+	return this->pages.back();
+}
+
+TextureAtlas::Region TextureAtlas::allocate(Page& page, std::uint32_t width, std::uint32_t height)
+{
+	std::uint32_t paddedWidth = width + 2 * PADDING;
+	std::uint32_t paddedHeight = height + 2 * PADDING;
+
+	Region region;
+	region.width = width;
+	region.height = height;
+
+	auto freeSlot = std::find_if(page.freeSlots.begin(), page.freeSlots.end(), [&](const Region& slot) {
+		return slot.slotWidth >= paddedWidth && slot.slotHeight >= paddedHeight;
+	});
+	if(freeSlot != page.freeSlots.end())
+	{
+		region.texture = page.texture;
+		region.x = freeSlot->x;
+		region.y = freeSlot->y;
+		region.slotWidth = freeSlot->slotWidth;
+		region.slotHeight = freeSlot->slotHeight;
+		page.freeSlots.erase(freeSlot);
+		return region;
+	}
+
+	// Lowest shelf the image fits on, so tall shelves are left for tall images
+	Shelf* shelf = nullptr;
+	for(auto& existingShelf : page.shelves)
+		if(existingShelf.height >= paddedHeight
+			&& PAGE_SIZE - existingShelf.nextX >= paddedWidth
+			&& (!shelf || existingShelf.height < shelf->height))
+			shelf = &existingShelf;
+	if(!shelf)
+	{
+		if(PAGE_SIZE - page.nextShelfY < paddedHeight)
+			return region;
+
+		page.shelves.push_back(Shelf{page.nextShelfY, paddedHeight, 0});
+		page.nextShelfY += paddedHeight;
+		shelf = &page.shelves.back();
+	}
+
+	region.texture = page.texture;
+	region.x = shelf->nextX + PADDING;
+	region.y = shelf->y + PADDING;
+	region.slotWidth = paddedWidth;
+	region.slotHeight = shelf->height;
+	shelf->nextX += paddedWidth;
+	return region;
+}
+
+TextureAtlas::Region TextureAtlas::add(const Ogre::uint8* texels, std::uint32_t width, std::uint32_t height)
+{
+	std::uint32_t paddedWidth = width + 2 * PADDING;
+	std::uint32_t paddedHeight = height + 2 * PADDING;
+	if(width == 0 || height == 0 || paddedWidth > PAGE_SIZE || paddedHeight > PAGE_SIZE)
+		return {};
+
+	Region region;
+	for(auto& page : this->pages)
+	{
+		region = this->allocate(page, width, height);
+		if(region.texture)
+		{
+			++page.numRegions;
+			break;
+		}
+	}
+	if(!region.texture)
+	{
+		Page& page = this->addPage();
+		region = this->allocate(page, width, height);
+		++page.numRegions;
+	}
+	assert(region.texture);
+
+	// Repeat edge texels into the padding
+	std::vector<Ogre::uint8> padded(paddedWidth * paddedHeight * 4);
+	for(std::uint32_t y = 0; y < paddedHeight; ++y)
+	{
+		std::uint32_t srcY = std::min(std::max(y, PADDING) - PADDING, height - 1);
+		for(std::uint32_t x = 0; x < paddedWidth; ++x)
+		{
+			std::uint32_t srcX = std::min(std::max(x, PADDING) - PADDING, width - 1);
+			std::copy_n(
+				texels + (srcY * width + srcX) * 4,
+				4,
+				padded.data() + (y * paddedWidth + x) * 4);
+		}
+	}
+
+	Ogre::TextureGpuManager* textureManager = Ogre::Root::getSingleton()
+		.getRenderSystem()
+		->getTextureGpuManager();
+	Ogre::StagingTexture* stagingTexture = textureManager->getStagingTexture(
+		paddedWidth, paddedHeight, 1u, 1u, Ogre::PixelFormatGpu::PFG_RGBA8_UNORM);
+	stagingTexture->startMapRegion();
+	Ogre::TextureBox box = stagingTexture->mapRegion(
+		paddedWidth, paddedHeight, 1u, 1u, Ogre::PixelFormatGpu::PFG_RGBA8_UNORM);
+	Ogre::TextureBox srcBox(
+		paddedWidth, paddedHeight, 1u, 1u, 4u,
+		paddedWidth * 4u, paddedWidth * paddedHeight * 4u);
+	srcBox.data = padded.data();
+	box.copyFrom(srcBox);
+	stagingTexture->stopMapRegion();
+
+	Ogre::TextureBox dstBox = region.texture->getEmptyBox(0);
+	dstBox.x = region.x - PADDING;
+	dstBox.y = region.y - PADDING;
+	dstBox.width = paddedWidth;
+	dstBox.height = paddedHeight;
+	stagingTexture->upload(box, region.texture, 0, nullptr, &dstBox);
+	textureManager->removeStagingTexture(stagingTexture);
+
+	return region;
+}
+
+void TextureAtlas::release(const Region& region)
+{
+	this->releasedRegions.push_back(region);
+}
+
+void TextureAtlas::update()
+{
+	for(auto& region : this->releasedRegions)
+		for(auto& page : this->pages)
+			if(page.texture == region.texture)
+			{
+				// Start packing empty pages again from the top
+				if(--page.numRegions == 0)
+				{
+					page.shelves.clear();
+					page.nextShelfY = 0;
+					page.freeSlots.clear();
+				}
+				else
+					page.freeSlots.push_back(region);
+				break;
+			}
+	this->releasedRegions.clear();
+}
@@ -0,0 +1,85 @@
+#ifndef NIMBLE_RMLOGRE_TEXTUREATLAS_HPP
+#define NIMBLE_RMLOGRE_TEXTUREATLAS_HPP
+
+#include <OgreMatrix4.h>
+#include <OgrePrerequisites.h>
+
+#include <cstdint>
+#include <vector>
+
+
+namespace Ogre {
+
+class TextureGpu;
+
+}
+
+namespace nimble::RmlOgre {
+
+// Small images packed into shared textures, on shelves of rows
+class TextureAtlas
+{
+public:
+	static constexpr std::uint32_t PAGE_SIZE = 1024;
+	// Around each image, filled with its edge texels so filtering doesn't bleed in neighbours
+	static constexpr std::uint32_t PADDING = 1;
+
+	struct Region
+	{
+		Ogre::TextureGpu* texture = nullptr;
+		std::uint32_t x = 0;
+		std::uint32_t y = 0;
+		std::uint32_t width = 0;
+		std::uint32_t height = 0;
+		// Slot the image was packed in, from (x - PADDING, y - PADDING)
+		std::uint32_t slotWidth = 0;
+		std::uint32_t slotHeight = 0;
+
+		// Maps the image's texture coordinates to the page's
+		Ogre::Matrix4 uvTransform() const;
+	};
+
+private:
+	struct Shelf
+	{
+		std::uint32_t y = 0;
+		std::uint32_t height = 0;
+		std::uint32_t nextX = 0;
+	};
+
+	struct Page
+	{
+		Ogre::TextureGpu* texture = nullptr;
+		std::vector<Shelf> shelves;
+		std::uint32_t nextShelfY = 0;
+		// Released regions, their slots are reused whole by images that fit
+		std::vector<Region> freeSlots;
+		std::size_t numRegions = 0;
+	};
+
+	Ogre::String name;
+	std::vector<Page> pages;
+	// Regions may still be used by queued rendering until the next frame
+	std::vector<Region> releasedRegions;
+
+	Page& addPage();
+	// Texture is null if the page has no space
+	Region allocate(Page& page, std::uint32_t width, std::uint32_t height);
+
+public:
+	TextureAtlas(Ogre::String name);
+	~TextureAtlas();
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	// Uploads width * height premultiplied RGBA8 texels, texture is null if too large for a page
+	Region add(const Ogre::uint8* texels, std::uint32_t width, std::uint32_t height);
+	void release(const Region& region);
+
+	// Free released regions, they mustn't be used by any queued rendering
+	void update();
+};
+
+}
+
+#endif // NIMBLE_RMLOGRE_TEXTUREATLAS_HPP
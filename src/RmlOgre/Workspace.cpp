@@ -5,8 +5,10 @@
 #include <Compositor/OgreCompositorManager2.h>
 #include <Compositor/OgreCompositorNode.h>
 #include <Compositor/OgreCompositorWorkspace.h>
+#include <Compositor/OgreCompositorWorkspaceDef.h>
 #include <Compositor/OgreCompositorNodeDef.h>
 #include <OgreCamera.h>
+#include <OgreDepthBuffer.h>
 #include <OgrePixelFormatGpuUtils.h>
 #include <OgreRoot.h>
 #include <OgreTextureGpuManager.h>
@@ -85,6 +87,22 @@ void connect_nodes(
 		outNode->connectTo(i, inNode, i);
 }
 
+// Single channel targets of Rml/DropShadow
+const std::array<const char*, 2> SHADOW_TEXTURES{"global_rmlShadow0", "global_rmlShadow1"};
+
+void add_shadow_texture(Ogre::CompositorWorkspaceDef* workspaceDef, const Ogre::String& name)
+{
+	for(auto& textureDef : workspaceDef->getTextureDefinitions())
+		if(textureDef.getName() == Ogre::IdString(name))
+			return;
+
+	auto* textureDef = workspaceDef->addTextureDefinition(name);
+	textureDef->format = Ogre::PFG_R16_FLOAT;
+	textureDef->depthBufferId = Ogre::DepthBuffer::POOL_NO_DEPTH;
+	auto* renderTargetView = workspaceDef->addRenderTextureView(name);
+	renderTargetView->setForTextureDefinition(name, textureDef);
+}
+
 std::size_t grow_capacity(std::size_t current, std::size_t min)
 {
 	if(min > 0)
@@ -137,6 +155,17 @@ Workspace::Workspace(
 		->getCompositorPassesNonConst()[0])
 		->mMaterialName = "Rml/ScissorCopy";
 
+	// Extract alpha, blur horizontally, blur vertically, then composite with the shadow
+	auto* dropShadowDef = compositorManager->getNodeDefinitionNonConst("Rml/DropShadow");
+	auto dropShadowPass = [&](std::size_t target) {
+		return static_cast<CompositorPassRenderQuadDef*>(dropShadowDef
+			->getTargetPass(target)
+			->getCompositorPassesNonConst()[0]);
+	};
+	dropShadowPass(1)->setQuadTextureSource(0, SHADOW_TEXTURES[0]);
+	dropShadowPass(2)->setQuadTextureSource(0, SHADOW_TEXTURES[1]);
+	dropShadowPass(3)->setQuadTextureSource(1, SHADOW_TEXTURES[0]);
+
 	this->reserveRenderTextures(4);
 
 	this->output(output);
@@ -214,6 +243,9 @@ void Workspace::buildWorkspace(const std::array<std::size_t, NUM_NODE_TYPES>& re
 	}
 	this->workspaceDef->connectExternal(0, "Rml/End", 1);
 
+	for(const char* name : SHADOW_TEXTURES)
+		add_shadow_texture(this->workspaceDef, name);
+
 	std::array<std::vector<Ogre::IdString>, NUM_NODE_TYPES> nodeTypeNames;
 	// Start from 1 to skip null passes
 	for(std::size_t i = 1; i < reservedNodes.size(); ++i)
@@ -291,27 +323,37 @@ void Workspace::ensureWorkspaceNodes(const std::array<std::size_t, NUM_NODE_TYPE
 	}
 }
 
+std::pair<Ogre::TextureGpu*, std::size_t> Workspace::createRenderTexture(
+	const RenderTexturePool::Format& format,
+	bool claimed)
+{
+	Ogre::String id = this->workspaceDef->getNameStr();
+	id.append("_RenderTexture_");
+	id.append(std::to_string(this->renderTextures.size()));
+	Ogre::uint32 flags = Ogre::TextureFlags::RenderToTexture;
+	if(format.mipmaps)
+		flags |= Ogre::TextureFlags::AllowAutomipmaps;
+	auto* texture = Ogre::Root::getSingleton()
+		.getRenderSystem()
+		->getTextureGpuManager()
+		->createTexture(
+			id,
+			Ogre::GpuPageOutStrategy::SaveToSystemRam,
+			flags,
+			Ogre::TextureTypes::Type2D);
+	texture->setPixelFormat(format.pixelFormat);
+	texture->setResolution(format.width, format.height);
+	texture->setNumMipmaps(format.mipmaps
+		? Ogre::PixelFormatGpuUtils::getMaxMipmapCount(format.width, format.height)
+		: 1u);
+	texture->scheduleTransitionTo(Ogre::GpuResidency::Resident);
+	return this->renderTextures.add(texture, claimed);
+}
 void Workspace::reserveRenderTextures(std::size_t capacity)
 {
+	// Spares, resized when claimed
 	while(this->renderTextures.size() < capacity)
-	{
-		Ogre::String id = this->workspaceDef->getNameStr();
-		id.append("_RenderTexture_");
-		id.append(std::to_string(this->renderTextures.size()));
-		auto* texture = Ogre::Root::getSingleton()
-			.getRenderSystem()
-			->getTextureGpuManager()
-			->createTexture(
-				id,
-				Ogre::GpuPageOutStrategy::SaveToSystemRam,
-				Ogre::TextureFlags::RenderToTexture | Ogre::TextureFlags::AllowAutomipmaps,
-				Ogre::TextureTypes::Type2D);
-		texture->setPixelFormat(Ogre::PixelFormatGpu::PFG_RGBA8_UNORM_SRGB);
-		texture->setResolution(1, 1);
-		texture->setNumMipmaps(8);
-		texture->scheduleTransitionTo(Ogre::GpuResidency::Resident);
-		this->renderTextures.add(texture);
-	}
+		this->createRenderTexture({});
 }
 void Workspace::reserveRenderObjects(std::size_t capacity)
 {
@@ -497,13 +539,21 @@ Ogre::uint32 Workspace::height() const
 	return this->output_->getHeight();
 }
 
-std::pair<Ogre::TextureGpu*, std::size_t> Workspace::getRenderTexture()
+std::pair<Ogre::TextureGpu*, std::size_t> Workspace::getRenderTexture(const RenderTexturePool::Format& format)
 {
-	if(this->renderTextures.full())
-		this->reserveRenderTextures(2 * this->renderTextures.size());
+	RenderTexturePool::Format classFormat = RenderTexturePool::sizeClass(format);
+	auto claimed = this->renderTextures.claim(classFormat);
+	if(claimed)
+		return *claimed;
 
-	auto claimed = this->renderTextures.claim();
-	return {claimed.first, claimed.second};
+	// Create the claimed texture, and spares of the same format so the
+	// workspace's external textures are rebuilt less often. Spares left
+	// unused are shrunk by shrinkRenderTextures.
+	std::size_t capacity = 2 * this->renderTextures.size();
+	auto created = this->createRenderTexture(classFormat, true);
+	while(this->renderTextures.size() < capacity)
+		this->createRenderTexture(classFormat);
+	return created;
 }
 bool Workspace::freeRenderTexture(Ogre::TextureGpu* texture)
 {
@@ -3,7 +3,7 @@
 
 #include "Pass.hpp"
 #include "RenderObject.hpp"
-#include "ResourcePool.hpp"
+#include "RenderTexturePool.hpp"
 
 #include <Math/Array/OgreObjectMemoryManager.h>
 #include <Math/Array/OgreNodeMemoryManager.h>
@@ -81,7 +81,7 @@ class Workspace : public Ogre::TextureGpuListener
 
 	Ogre::TextureGpu* output_ = nullptr;
 	Ogre::TextureGpu* background_ = nullptr;
-	ResourcePool<Ogre::TextureGpu*> renderTextures;
+	RenderTexturePool renderTextures;
 
 	Ogre::CompositorWorkspace* workspace = nullptr;
 	Ogre::CompositorWorkspaceDef* workspaceDef = nullptr;
@@ -90,6 +90,9 @@ class Workspace : public Ogre::TextureGpuListener
 	void buildWorkspace(const std::array<std::size_t, NUM_NODE_TYPES>& reservedNodes);
 	void ensureWorkspaceNodes(const std::array<std::size_t, NUM_NODE_TYPES>& minNodes);
 
+	std::pair<Ogre::TextureGpu*, std::size_t> createRenderTexture(
+		const RenderTexturePool::Format& format,
+		bool claimed = false);
 	void reserveRenderTextures(std::size_t capacity);
 	void reserveRenderObjects(std::size_t capacity);
 	void reserveSceneNodes(std::size_t capacity);
@@ -120,8 +123,12 @@ public:
 	Ogre::uint32 height() const;
 	const Ogre::Matrix4& projectionMatrix() const { return this->projectionMatrix_; }
 
-	std::pair<Ogre::TextureGpu*, std::size_t> getRenderTexture();
+	// Resident texture of at least the format's size and its external texture index,
+	// see RenderTexturePool::sizeClass
+	std::pair<Ogre::TextureGpu*, std::size_t> getRenderTexture(const RenderTexturePool::Format& format);
 	bool freeRenderTexture(Ogre::TextureGpu* texture);
+	void shrinkRenderTextures(std::uint64_t unusedFrames) { this->renderTextures.beginFrame(unusedFrames); }
+	const RenderTexturePool::Stats& renderTextureStats() const { return this->renderTextures.getStats(); }
 
 	Ogre::TextureGpu* output() const;
 	void output(Ogre::TextureGpu* texture);
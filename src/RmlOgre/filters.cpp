@@ -6,11 +6,16 @@
 #include <OgreGpuProgramParams.h>
 #include <OgreMaterial.h>
 #include <OgreMaterialManager.h>
+#include <OgrePixelFormatGpuUtils.h>
 #include <OgreTechnique.h>
+#include <OgreTextureGpu.h>
 
 #include <RmlUi/Core/Dictionary.h>
 #include <RmlUi/Core/DecorationTypes.h>
 
+#include <algorithm>
+#include <cmath>
+
 
 using namespace nimble::RmlOgre;
 
@@ -24,6 +29,14 @@ Ogre::Vector4 to_ogre(Rml::ColourbPremultiplied c)
 	return result;
 }
 
+Rml::Rectanglei clamp_region(const Rml::Rectanglei& region, Rml::Vector2i size)
+{
+	auto clamp = [size](Rml::Vector2i p) {
+		return Rml::Vector2i{Rml::Math::Clamp(p.x, 0, size.x), Rml::Math::Clamp(p.y, 0, size.y)};
+	};
+	return Rml::Rectanglei::FromCorners(clamp(region.p0), clamp(region.p1));
+}
+
 }
 
 void BlurFilter::apply(RenderInterface& renderInterface)
@@ -46,24 +59,67 @@ void BlurFilter::apply(RenderInterface& renderInterface)
 	renderInterface.addPass(RenderQuadPass(this->blurV, renderInterface.currentRenderPassSettings()));
 }
 
+void BlurFilter::release(RenderInterface& renderInterface)
+{
+	renderInterface.getMaterialCache().release(this->blurH);
+	renderInterface.getMaterialCache().release(this->blurV);
+}
+
+void DualBlurFilter::apply(RenderInterface& renderInterface)
+{
+	// Always scissor so lower levels only render their part of the target
+	RenderPassSettings passSettings = renderInterface.currentRenderPassSettings();
+	if(!passSettings.enableScissor)
+	{
+		passSettings.enableScissor = true;
+		passSettings.scissorRegion = Rml::Rectanglei::FromSize(renderInterface.currentOutputSize());
+	}
+
+	std::vector<Rml::Rectanglei> regions{passSettings.scissorRegion};
+	for(int i = 0; i < this->iterations; ++i)
+	{
+		Rml::Rectanglei region = regions.back();
+		region.p0 /= 2;
+		region.p1 = (region.p1 + Rml::Vector2i{1, 1}) / 2;
+		regions.push_back(region);
+
+		passSettings.scissorRegion = region;
+		renderInterface.addPass(RenderQuadPass(this->downsample, passSettings));
+	}
+	for(int i = this->iterations - 1; i >= 0; --i)
+	{
+		passSettings.scissorRegion = regions[i];
+		renderInterface.addPass(RenderQuadPass(this->upsample, passSettings));
+	}
+}
+
+void DualBlurFilter::release(RenderInterface& renderInterface)
+{
+	renderInterface.getMaterialCache().release(this->downsample);
+	renderInterface.getMaterialCache().release(this->upsample);
+}
+
 BlurFilterMaker::BlurFilterMaker()
 {
 	this->halfsampleMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/Halfsample");
 	this->blurMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/Blur");
+	this->dualDownsampleMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/DualDownsample");
+	this->dualUpsampleMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/DualUpsample");
 }
 
-BlurFilter BlurFilterMaker::make(float sigma)
+float BlurFilterMaker::maxScaledSigma(BlurQuality quality)
 {
-	int halfsamples = 0;
-	int step = 1;
-	while(sigma > MAX_SCALED_SIGMA * step)
-	{
-		halfsamples += 1;
-		step *= 2;
-	}
-	float scale = 1.0f / step;
+	if(quality == BlurQuality::Medium)
+		return 2.0f;
+	else if(quality == BlurQuality::Low)
+		return 1.5f;
+	else
+		return MAX_SCALED_SIGMA;
+}
 
-	std::array<float, NUM_WEIGHTS> weights;
+std::array<float, BlurFilterMaker::NUM_WEIGHTS> BlurFilterMaker::gaussianWeights(float sigma, int step)
+{
+	std::array<float, NUM_WEIGHTS> weights{};
 	if(sigma < 0.1f)
 		weights[0] = 1.0f;
 	else
@@ -80,41 +136,74 @@ BlurFilter BlurFilterMaker::make(float sigma)
 		for(float& weight : weights)
 			weight /= weightsTotal;
 	}
+	return weights;
+}
 
-	Ogre::MaterialPtr blurH(OGRE_NEW Ogre::Material(nullptr, "", 0, "", false, nullptr));
-	*blurH = *this->blurMaterial;
-	blurH->load();
-	{
-		auto* pass = blurH
-			->getBestTechnique()
-			->getPass(0);
-		auto vertexProgramParameters = pass->getVertexProgramParameters();
-		vertexProgramParameters->setNamedConstant("scale", Ogre::Vector2{scale, 1.0f});
-		auto fragmentProgramParameters = pass->getFragmentProgramParameters();
-		fragmentProgramParameters->setNamedConstant("direction", Ogre::Vector2{1.0f, 0.0f});
-		fragmentProgramParameters->setNamedConstant("weights", weights.data(), weights.size() / 4);
-	}
+std::unique_ptr<Filter> BlurFilterMaker::makeGaussian(float sigma, BlurQuality quality)
+{
+	float maxSigma = BlurFilterMaker::maxScaledSigma(quality);
 
-	Ogre::MaterialPtr blurV(OGRE_NEW Ogre::Material(nullptr, "", 0, "", false, nullptr));
-	*blurV = *this->blurMaterial;
-	blurV->load();
+	int halfsamples = 0;
+	int step = 1;
+	while(sigma > maxSigma * step)
 	{
-		auto* pass = blurV
-			->getBestTechnique()
-			->getPass(0);
-		auto vertexProgramParameters = pass->getVertexProgramParameters();
-		vertexProgramParameters->setNamedConstant("scale", Ogre::Vector2{1.0f, scale});
-		auto fragmentProgramParameters = pass->getFragmentProgramParameters();
-		fragmentProgramParameters->setNamedConstant("direction", Ogre::Vector2{0.0f, 1.0f});
-		fragmentProgramParameters->setNamedConstant("weights", weights.data(), weights.size() / 4);
+		halfsamples += 1;
+		step *= 2;
 	}
+	float scale = 1.0f / step;
+
+	auto weights = gaussianWeights(sigma, step);
+	std::vector<float> weightsValue(weights.begin(), weights.end());
+	auto blurH = this->materialCache->acquire(this->blurMaterial, {
+		{Ogre::GPT_VERTEX_PROGRAM, "scale", Ogre::Vector2{scale, 1.0f}},
+		{Ogre::GPT_FRAGMENT_PROGRAM, "direction", Ogre::Vector2{1.0f, 0.0f}},
+		{Ogre::GPT_FRAGMENT_PROGRAM, "weights", weightsValue}
+	});
+	auto blurV = this->materialCache->acquire(this->blurMaterial, {
+		{Ogre::GPT_VERTEX_PROGRAM, "scale", Ogre::Vector2{1.0f, scale}},
+		{Ogre::GPT_FRAGMENT_PROGRAM, "direction", Ogre::Vector2{0.0f, 1.0f}},
+		{Ogre::GPT_FRAGMENT_PROGRAM, "weights", weightsValue}
+	});
+
+	return std::make_unique<BlurFilter>(this->halfsampleMaterial, blurH, blurV, halfsamples);
+}
+
+std::unique_ptr<Filter> BlurFilterMaker::makeDual(float sigma, BlurQuality quality)
+{
+	// Larger offsets need fewer passes but sample more sparsely
+	float maxOffset = 1.0f;
+	if(quality == BlurQuality::Medium)
+		maxOffset = 1.5f;
+	else if(quality == BlurQuality::Low)
+		maxOffset = 2.0f;
+
+	int iterations = 1;
+	while(sigma > DUAL_SIGMA_SCALE * maxOffset * (1 << iterations) && iterations < MAX_DUAL_ITERATIONS)
+		++iterations;
+	float offset = sigma / (DUAL_SIGMA_SCALE * (1 << iterations));
+
+	auto downsample = this->materialCache->acquire(this->dualDownsampleMaterial, {
+		{Ogre::GPT_FRAGMENT_PROGRAM, "offset", offset}
+	});
+	auto upsample = this->materialCache->acquire(this->dualUpsampleMaterial, {
+		{Ogre::GPT_FRAGMENT_PROGRAM, "offset", offset}
+	});
+
+	return std::make_unique<DualBlurFilter>(downsample, upsample, iterations);
+}
 
-	return BlurFilter(this->halfsampleMaterial, blurH, blurV, halfsamples);
+std::unique_ptr<Filter> BlurFilterMaker::make(float sigma)
+{
+	const BlurSettings& settings = this->getSettings();
+	if(settings.mode == BlurMode::Dual && sigma >= MIN_DUAL_SIGMA)
+		return this->makeDual(sigma, settings.quality);
+	else
+		return this->makeGaussian(sigma, settings.quality);
 }
 
 std::unique_ptr<Filter> BlurFilterMaker::make(const Rml::Dictionary& parameters)
 {
-	return std::make_unique<BlurFilter>(this->make(Rml::Get(parameters, "sigma", 0.0f)));
+	return this->make(Rml::Get(parameters, "sigma", 0.0f));
 }
 
 
@@ -126,7 +215,7 @@ void DropShadowFilter::apply(RenderInterface& renderInterface)
 	renderInterface.addPass(CopyPass(renderInterface.acquireLayerBuffer().connectionId, tempLayer));
 
 	renderInterface.addPass(RenderQuadPass(this->shadowMaterial, passSettings));
-	this->blurFilter.apply(renderInterface);
+	this->blurFilter->apply(renderInterface);
 
 	int shadowLayer = renderInterface.addConnection();
 	renderInterface.addPass(SwapPass(tempLayer, shadowLayer));
@@ -135,11 +224,118 @@ void DropShadowFilter::apply(RenderInterface& renderInterface)
 	renderInterface.releaseLayerBuffer(Layer{discardCopy, -1});
 }
 
+void DropShadowFilter::release(RenderInterface& renderInterface)
+{
+	this->blurFilter->release(renderInterface);
+	renderInterface.getMaterialCache().release(this->shadowMaterial);
+}
+
+void AlphaDropShadowFilter::apply(RenderInterface& renderInterface)
+{
+	const RenderPassSettings& settings = renderInterface.currentRenderPassSettings();
+	Rml::Vector2i size = renderInterface.currentOutputSize();
+	Rml::Rectanglei target = settings.enableScissor
+		? settings.scissorRegion
+		: Rml::Rectanglei::FromSize(size);
+
+	// Shadow texels read by the composite, with another texel for bilinear filtering
+	float step = float(this->step);
+	Rml::Rectanglei shadowRegion = Rml::Rectanglei::FromCorners(
+		Rml::Vector2i{
+			int(std::floor((target.Left() - this->offset.x) / step)) - 1,
+			int(std::floor((target.Top() - this->offset.y) / step)) - 1
+		},
+		Rml::Vector2i{
+			int(std::ceil((target.Right() - this->offset.x) / step)) + 1,
+			int(std::ceil((target.Bottom() - this->offset.y) / step)) + 1
+		}
+	);
+	// Each blur reads texels either side, which must be written by the pass before.
+	// Texels outside the target are read as transparent.
+	Rml::Vector2i margin{BlurFilterMaker::NUM_WEIGHTS, BlurFilterMaker::NUM_WEIGHTS};
+	Rml::Vector2i marginV{0, BlurFilterMaker::NUM_WEIGHTS};
+	Rml::Rectanglei blurHRegion = clamp_region(
+		Rml::Rectanglei::FromCorners(shadowRegion.p0 - marginV, shadowRegion.p1 + marginV), size);
+	Rml::Rectanglei extractRegion = clamp_region(
+		Rml::Rectanglei::FromCorners(shadowRegion.p0 - margin, shadowRegion.p1 + margin), size);
+	shadowRegion = clamp_region(shadowRegion, size);
+
+	RenderPassSettings passSettings = settings;
+	passSettings.enableScissor = true;
+	auto withRegion = [&passSettings](const Rml::Rectanglei& region) {
+		passSettings.scissorRegion = region;
+		return passSettings;
+	};
+	renderInterface.addPass(DropShadowPass({
+		RenderQuadPass(this->extract, withRegion(extractRegion)),
+		RenderQuadPass(this->blurH, withRegion(blurHRegion)),
+		RenderQuadPass(this->blurV, withRegion(shadowRegion)),
+		RenderQuadPass(this->composite, settings)
+	}));
+}
+
+void AlphaDropShadowFilter::release(RenderInterface& renderInterface)
+{
+	renderInterface.getMaterialCache().release(this->extract);
+	renderInterface.getMaterialCache().release(this->blurH);
+	renderInterface.getMaterialCache().release(this->blurV);
+	renderInterface.getMaterialCache().release(this->composite);
+}
+
 DropShadowFilterMaker::DropShadowFilterMaker()
 {
 	this->shadowMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/Shadow");
 	this->blurlessShadowMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/BlurlessShadow");
+	this->shadowAlphaMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/ShadowAlpha");
+	this->blurMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/Blur");
+	this->shadowCompositeMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/ShadowComposite");
+}
+void DropShadowFilterMaker::setMaterialCache(MaterialCache* materialCache)
+{
+	FilterMaker::setMaterialCache(materialCache);
+	this->blurFilterMaker.setMaterialCache(materialCache);
 }
+std::unique_ptr<Filter> DropShadowFilterMaker::makeAlphaOnly(
+	float sigma,
+	Rml::ColourbPremultiplied colour,
+	Rml::Vector2f offset)
+{
+	float maxSigma = BlurFilterMaker::maxScaledSigma(this->blurFilterMaker.getSettings().quality);
+	int step = 1;
+	while(sigma > maxSigma * step)
+		step *= 2;
+	if(this->settings.halfResolution)
+		step = std::max(step, 2);
+	if(step > MAX_ALPHA_STEP)
+		return nullptr;
+
+	auto extract = this->materialCache->acquire(this->shadowAlphaMaterial, {
+		{Ogre::GPT_VERTEX_PROGRAM, "scale", Ogre::Vector2{float(step), float(step)}},
+		{Ogre::GPT_FRAGMENT_PROGRAM, "taps", float(std::max(step / 2, 1))}
+	});
+
+	auto weights = BlurFilterMaker::gaussianWeights(sigma, step);
+	std::vector<float> weightsValue(weights.begin(), weights.end());
+	auto blurH = this->materialCache->acquire(this->blurMaterial, {
+		{Ogre::GPT_VERTEX_PROGRAM, "scale", Ogre::Vector2{1.0f, 1.0f}},
+		{Ogre::GPT_FRAGMENT_PROGRAM, "direction", Ogre::Vector2{1.0f, 0.0f}},
+		{Ogre::GPT_FRAGMENT_PROGRAM, "weights", weightsValue}
+	});
+	auto blurV = this->materialCache->acquire(this->blurMaterial, {
+		{Ogre::GPT_VERTEX_PROGRAM, "scale", Ogre::Vector2{1.0f, 1.0f}},
+		{Ogre::GPT_FRAGMENT_PROGRAM, "direction", Ogre::Vector2{0.0f, 1.0f}},
+		{Ogre::GPT_FRAGMENT_PROGRAM, "weights", weightsValue}
+	});
+
+	auto composite = this->materialCache->acquire(this->shadowCompositeMaterial, {
+		{Ogre::GPT_FRAGMENT_PROGRAM, "colour", to_ogre(colour)},
+		{Ogre::GPT_FRAGMENT_PROGRAM, "offset", Ogre::Vector2{offset.x, offset.y}},
+		{Ogre::GPT_FRAGMENT_PROGRAM, "scale", 1.0f / step}
+	});
+
+	return std::make_unique<AlphaDropShadowFilter>(extract, blurH, blurV, composite, offset, step);
+}
+
 std::unique_ptr<Filter> DropShadowFilterMaker::make(const Rml::Dictionary& parameters)
 {
 	float sigma = Rml::Get(parameters, "sigma", 0.0f);
@@ -148,19 +344,17 @@ std::unique_ptr<Filter> DropShadowFilterMaker::make(const Rml::Dictionary& param
 
 	if(sigma > 0.5f)
 	{
-		Ogre::MaterialPtr shadowMaterial(OGRE_NEW Ogre::Material(nullptr, "", 0, "", false, nullptr));
-		*shadowMaterial = *this->shadowMaterial;
-		shadowMaterial->load();
+		if(this->settings.alphaOnly)
 		{
-			auto* pass = shadowMaterial
-				->getBestTechnique()
-				->getPass(0);
-			auto vertexProgramParameters = pass->getVertexProgramParameters();
-			vertexProgramParameters->setNamedConstant("offset", Ogre::Vector2{offset.x, offset.y});
-			auto fragmentProgramParameters = pass->getFragmentProgramParameters();
-			fragmentProgramParameters->setNamedConstant("colour", to_ogre(colour));
+			if(auto filter = this->makeAlphaOnly(sigma, colour, offset))
+				return filter;
 		}
 
+		auto shadowMaterial = this->materialCache->acquire(this->shadowMaterial, {
+			{Ogre::GPT_VERTEX_PROGRAM, "offset", Ogre::Vector2{offset.x, offset.y}},
+			{Ogre::GPT_FRAGMENT_PROGRAM, "colour", to_ogre(colour)}
+		});
+
 		return std::make_unique<DropShadowFilter>(
 			this->blurFilterMaker.make(sigma),
 			shadowMaterial
@@ -168,17 +362,10 @@ std::unique_ptr<Filter> DropShadowFilterMaker::make(const Rml::Dictionary& param
 	}
 	else
 	{
-		Ogre::MaterialPtr shadowMaterial(OGRE_NEW Ogre::Material(nullptr, "", 0, "", false, nullptr));
-		*shadowMaterial = *this->blurlessShadowMaterial;
-		shadowMaterial->load();
-		{
-			auto* pass = shadowMaterial
-				->getBestTechnique()
-				->getPass(0);
-			auto fragmentProgramParameters = pass->getFragmentProgramParameters();
-			fragmentProgramParameters->setNamedConstant("offset", Ogre::Vector2{offset.x, offset.y});
-			fragmentProgramParameters->setNamedConstant("colour", to_ogre(colour));
-		}
+		auto shadowMaterial = this->materialCache->acquire(this->blurlessShadowMaterial, {
+			{Ogre::GPT_FRAGMENT_PROGRAM, "offset", Ogre::Vector2{offset.x, offset.y}},
+			{Ogre::GPT_FRAGMENT_PROGRAM, "colour", to_ogre(colour)}
+		});
 
 		return std::make_unique<SingleMaterialFilter>(shadowMaterial);
 	}
@@ -192,15 +379,11 @@ OpacityFilterMaker::OpacityFilterMaker()
 
 std::unique_ptr<Filter> OpacityFilterMaker::make(const Rml::Dictionary& parameters)
 {
-	Ogre::MaterialPtr material(OGRE_NEW Ogre::Material(nullptr, "", 0, "", false, nullptr));
-	*material = *this->baseMaterial;
-	material->load();
-	auto fragmentProgramParameters = material
-		->getBestTechnique()
-		->getPass(0)
-		->getFragmentProgramParameters();
-	fragmentProgramParameters->setNamedConstant("value", Rml::Get(parameters, "value", 1.0f));
-	return std::make_unique<SingleMaterialFilter>(material);
+	float value = Rml::Get(parameters, "value", 1.0f);
+	auto material = this->materialCache->acquire(this->baseMaterial, {
+		{Ogre::GPT_FRAGMENT_PROGRAM, "value", value}
+	});
+	return std::make_unique<OpacityFilter>(material, value);
 }
 
 
@@ -211,15 +394,10 @@ ColourMatrixFilterMaker::ColourMatrixFilterMaker()
 
 std::unique_ptr<Filter> ColourMatrixFilterMaker::make(const Ogre::Matrix4& matrix)
 {
-	Ogre::MaterialPtr material(OGRE_NEW Ogre::Material(nullptr, "", 0, "", false, nullptr));
-	*material = *this->baseMaterial;
-	material->load();
-	material
-		->getBestTechnique()
-		->getPass(0)
-		->getFragmentProgramParameters()
-		->setNamedConstant("colourMatrix", matrix);
-	return std::make_unique<SingleMaterialFilter>(material);
+	auto material = this->materialCache->acquire(this->baseMaterial, {
+		{Ogre::GPT_FRAGMENT_PROGRAM, "colourMatrix", matrix}
+	});
+	return std::make_unique<ColourMatrixFilter>(material, matrix);
 }
 
 
@@ -311,18 +489,16 @@ std::unique_ptr<Filter> SaturateFilterMaker::make(const Rml::Dictionary& paramet
 MaskImageFilterMaker::MaskImageFilterMaker()
 {
 	this->baseMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/Mask");
+	this->redMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/MaskRed");
 }
 
-SingleMaterialFilter MaskImageFilterMaker::make(Ogre::TextureGpu* image)
+SingleMaterialFilter MaskImageFilterMaker::make(Ogre::TextureGpu* image, Ogre::Vector2 scale)
 {
-	Ogre::MaterialPtr material(OGRE_NEW Ogre::Material(nullptr, "", 0, "", false, nullptr));
-	*material = *this->baseMaterial;
-	material->load();
-	auto textureUnit = material
-		->getBestTechnique()
-		->getPass(0)
-		->getTextureUnitState("dstTex");
-	textureUnit->setTexture(image);
+	bool red = image && Ogre::PixelFormatGpuUtils::getNumberOfComponents(image->getPixelFormat()) == 1;
+	auto material = this->materialCache->acquire(red ? this->redMaterial : this->baseMaterial, {
+		{Ogre::GPT_FRAGMENT_PROGRAM, "dstTex", image},
+		{Ogre::GPT_FRAGMENT_PROGRAM, "maskScale", scale}
+	});
 	return SingleMaterialFilter(material);
 }
 
@@ -3,6 +3,10 @@
 
 #include "FilterMaker.hpp"
 
+#include <OgreVector2.h>
+
+#include <array>
+
 
 namespace nimble::RmlOgre {
 
@@ -27,12 +31,62 @@ public:
 	{}
 
 	void apply(RenderInterface& renderInterface) override;
+	void release(RenderInterface& renderInterface) override;
+};
+
+// Blur by downsampling and then upsampling through a pyramid of half
+// resolution levels, approximates a Gaussian blur at a fraction of the cost
+class DualBlurFilter : public Filter
+{
+	Ogre::MaterialPtr downsample;
+	Ogre::MaterialPtr upsample;
+	int iterations;
+
+public:
+	DualBlurFilter(
+		Ogre::MaterialPtr downsample,
+		Ogre::MaterialPtr upsample,
+		int iterations
+	) :
+		downsample{downsample},
+		upsample{upsample},
+		iterations{iterations}
+	{}
+
+	void apply(RenderInterface& renderInterface) override;
+	void release(RenderInterface& renderInterface) override;
+};
+
+enum class BlurMode
+{
+	Gaussian,
+	Dual
+};
+
+enum class BlurQuality
+{
+	Low,
+	Medium,
+	High
+};
+
+struct BlurSettings
+{
+	BlurMode mode = BlurMode::Gaussian;
+	// Lower quality downsamples more
+	BlurQuality quality = BlurQuality::High;
 };
 
 class BlurFilterMaker : public FilterMaker
 {
 	Ogre::MaterialPtr halfsampleMaterial;
 	Ogre::MaterialPtr blurMaterial;
+	Ogre::MaterialPtr dualDownsampleMaterial;
+	Ogre::MaterialPtr dualUpsampleMaterial;
+	BlurSettings settings;
+
+	std::unique_ptr<Filter> makeGaussian(float sigma, BlurQuality quality);
+	std::unique_ptr<Filter> makeDual(float sigma, BlurQuality quality);
 
 public:
 	// Must be same as:
@@ -40,27 +94,82 @@ public:
 	// NUM_WEIGHTS in media/scripts/material/Rml/HLSL/Blur_ps.hlsl
 	static constexpr int NUM_WEIGHTS = 8;
 	static constexpr float MAX_SCALED_SIGMA = 3.0f;
+	// Smaller blurs are cheap enough with the Gaussian blur
+	static constexpr float MIN_DUAL_SIGMA = 2.0f;
+	static constexpr int MAX_DUAL_ITERATIONS = 8;
+	// Approximate sigma of a dual blur is DUAL_SIGMA_SCALE * offset * 2^iterations
+	static constexpr float DUAL_SIGMA_SCALE = 0.75f;
+
+	// Largest sigma blurred without downsampling further
+	static float maxScaledSigma(BlurQuality quality);
+	// Normalised Gaussian weights for samples step texels apart
+	static std::array<float, NUM_WEIGHTS> gaussianWeights(float sigma, int step);
 
 	BlurFilterMaker();
-	BlurFilter make(float sigma);
+
+	const BlurSettings& getSettings() const { return this->settings; }
+	// Used by filters made afterwards
+	void setSettings(const BlurSettings& settings) { this->settings = settings; }
+
+	std::unique_ptr<Filter> make(float sigma);
 	std::unique_ptr<Filter> make(const Rml::Dictionary& parameters) override;
 };
 
 class DropShadowFilter : public Filter
 {
-	BlurFilter blurFilter;
+	std::unique_ptr<Filter> blurFilter;
 	Ogre::MaterialPtr shadowMaterial;
 
 public:
 	DropShadowFilter(
-		BlurFilter blurFilter,
+		std::unique_ptr<Filter> blurFilter,
 		Ogre::MaterialPtr shadowMaterial
 	) :
-		blurFilter{blurFilter},
+		blurFilter{std::move(blurFilter)},
 		shadowMaterial{shadowMaterial}
 	{}
 
 	void apply(RenderInterface& renderInterface) override;
+	void release(RenderInterface& renderInterface) override;
+};
+
+// Drop shadow blurred from alpha alone, in single channel targets at reduced resolution
+class AlphaDropShadowFilter : public Filter
+{
+	Ogre::MaterialPtr extract;
+	Ogre::MaterialPtr blurH;
+	Ogre::MaterialPtr blurV;
+	Ogre::MaterialPtr composite;
+	Rml::Vector2f offset;
+	int step;
+
+public:
+	AlphaDropShadowFilter(
+		Ogre::MaterialPtr extract,
+		Ogre::MaterialPtr blurH,
+		Ogre::MaterialPtr blurV,
+		Ogre::MaterialPtr composite,
+		Rml::Vector2f offset,
+		int step
+	) :
+		extract{extract},
+		blurH{blurH},
+		blurV{blurV},
+		composite{composite},
+		offset{offset},
+		step{step}
+	{}
+
+	void apply(RenderInterface& renderInterface) override;
+	void release(RenderInterface& renderInterface) override;
+};
+
+struct DropShadowSettings
+{
+	// Blur only the alpha in single channel targets, instead of a colourised copy of the layer
+	bool alphaOnly = true;
+	// Blur the alpha at half resolution or lower
+	bool halfResolution = true;
 };
 
 class DropShadowFilterMaker : public FilterMaker
@@ -68,12 +177,58 @@ class DropShadowFilterMaker : public FilterMaker
 	BlurFilterMaker blurFilterMaker;
 	Ogre::MaterialPtr shadowMaterial;
 	Ogre::MaterialPtr blurlessShadowMaterial;
+	Ogre::MaterialPtr shadowAlphaMaterial;
+	Ogre::MaterialPtr blurMaterial;
+	Ogre::MaterialPtr shadowCompositeMaterial;
+	DropShadowSettings settings;
+
+	std::unique_ptr<Filter> makeAlphaOnly(float sigma, Rml::ColourbPremultiplied colour, Rml::Vector2f offset);
 
 public:
+	// Larger downsampling takes too many samples when extracting alpha,
+	// those shadows are blurred in colour instead
+	static constexpr int MAX_ALPHA_STEP = 8;
+
 	DropShadowFilterMaker();
+	BlurFilterMaker& getBlurFilterMaker() { return this->blurFilterMaker; }
+	const DropShadowSettings& getSettings() const { return this->settings; }
+	void setSettings(const DropShadowSettings& settings) { this->settings = settings; }
+	void setMaterialCache(MaterialCache* materialCache) override;
 	std::unique_ptr<Filter> make(const Rml::Dictionary& parameters) override;
 };
 
+// Filter that multiplies colours by a matrix, can be combined with adjacent colour matrix filters
+class ColourMatrixFilter : public SingleMaterialFilter
+{
+	Ogre::Matrix4 matrix;
+
+public:
+	ColourMatrixFilter(Ogre::MaterialPtr material, const Ogre::Matrix4& matrix) :
+		SingleMaterialFilter(material),
+		matrix{matrix}
+	{}
+
+	const Ogre::Matrix4& getMatrix() const { return this->matrix; }
+};
+
+class OpacityFilter : public ColourMatrixFilter
+{
+	float value;
+
+public:
+	OpacityFilter(Ogre::MaterialPtr material, float value) :
+		ColourMatrixFilter(material, Ogre::Matrix4{
+			value, 0.0f,  0.0f,  0.0f,
+			0.0f,  value, 0.0f,  0.0f,
+			0.0f,  0.0f,  value, 0.0f,
+			0.0f,  0.0f,  0.0f,  value
+		}),
+		value{value}
+	{}
+
+	float getValue() const { return this->value; }
+};
+
 class OpacityFilterMaker : public FilterMaker
 {
 	Ogre::MaterialPtr baseMaterial;
@@ -145,11 +300,14 @@ public:
 class MaskImageFilterMaker : public FilterMaker
 {
 	Ogre::MaterialPtr baseMaterial;
+	// For single channel images, with alpha in the red channel
+	Ogre::MaterialPtr redMaterial;
 
 public:
 	MaskImageFilterMaker();
 
-	SingleMaterialFilter make(Ogre::TextureGpu* image);
+	// Scale is the fraction of the image used, from its top left
+	SingleMaterialFilter make(Ogre::TextureGpu* image, Ogre::Vector2 scale = Ogre::Vector2::UNIT_SCALE);
 	std::unique_ptr<Filter> make(const Rml::Dictionary& parameters) override;
 };
 
@@ -1,10 +1,15 @@
 #include "geometry.hpp"
 
+#include <OgreMath.h>
 #include <OgreRoot.h>
 #include <OgrePixelFormatGpuUtils.h>
 #include <Vao/OgreVaoManager.h>
 #include <Vao/OgreVertexArrayObject.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+
 
 using namespace nimble::RmlOgre;
 
@@ -96,3 +101,201 @@ Ogre::VertexArrayObject* nimble::RmlOgre::create_vao(
 		indexBuffer,
 		Ogre::OT_TRIANGLE_LIST);
 }
+
+namespace {
+
+// Whether all vertices are on corners of bounds, and triangles on opposite
+// sides of one of its diagonals cover it
+bool is_rectangle(
+	Rml::Span<const Rml::Vertex> vertices,
+	Rml::Span<const int> indices,
+	const Rml::Rectanglef& bounds)
+{
+	if(bounds.Width() <= 0.0f || bounds.Height() <= 0.0f || indices.size() % 3 != 0)
+		return false;
+
+	auto corner = [&bounds](Rml::Vector2f p) {
+		int x = p.x == bounds.p0.x ? 0 : p.x == bounds.p1.x ? 1 : -1;
+		int y = p.y == bounds.p0.y ? 0 : p.y == bounds.p1.y ? 2 : -1;
+		return x < 0 || y < 0 ? -1 : x + y;
+	};
+
+	// Bit i set when there's a triangle of the corners other than i
+	unsigned int triangles = 0;
+	for(std::size_t i = 0; i < indices.size(); i += 3)
+	{
+		unsigned int corners = 0;
+		for(std::size_t j = 0; j < 3; ++j)
+		{
+			int c = corner(vertices[indices[i + j]].position);
+			if(c < 0)
+				return false;
+			corners |= 1u << c;
+		}
+		// Degenerate triangles cover nothing
+		if(corners == 0b0111 || corners == 0b1011 || corners == 0b1101 || corners == 0b1110)
+			triangles |= ~corners & 0b1111;
+	}
+	// Corners 0 and 3, and 1 and 2, are diagonally opposite
+	return (triangles & 0b1001) == 0b1001 || (triangles & 0b0110) == 0b0110;
+}
+
+// Rml doesn't overlap triangles of a shape, so they fill the hull when their areas sum to its area
+std::vector<Rml::Vector2f> find_convex_hull(
+	Rml::Span<const Rml::Vertex> vertices,
+	Rml::Span<const int> indices)
+{
+	if(vertices.size() < 3 || vertices.size() > MAX_HULL_VERTICES || indices.size() % 3 != 0)
+		return {};
+
+	std::vector<Rml::Vector2f> points;
+	points.reserve(vertices.size());
+	for(auto& v : vertices)
+		points.push_back(v.position);
+	std::sort(points.begin(), points.end(), [](Rml::Vector2f a, Rml::Vector2f b) {
+		return a.x < b.x || (a.x == b.x && a.y < b.y);
+	});
+
+	// Monotone chain, lower then upper hull
+	std::vector<Rml::Vector2f> hull(2 * points.size());
+	std::size_t k = 0;
+	for(std::size_t i = 0; i < points.size(); ++i)
+	{
+		while(k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0.0f)
+			--k;
+		hull[k++] = points[i];
+	}
+	for(std::size_t i = points.size() - 1, lower = k + 1; i > 0; --i)
+	{
+		while(k >= lower && cross(hull[k - 2], hull[k - 1], points[i - 1]) <= 0.0f)
+			--k;
+		hull[k++] = points[i - 1];
+	}
+	hull.resize(k - 1);
+	if(hull.size() < 3)
+		return {};
+
+	float hullArea = 0.0f;
+	for(std::size_t i = 1; i + 1 < hull.size(); ++i)
+		hullArea += cross(hull[0], hull[i], hull[i + 1]);
+	float trianglesArea = 0.0f;
+	for(std::size_t i = 0; i < indices.size(); i += 3)
+		trianglesArea += std::abs(cross(
+			vertices[indices[i]].position,
+			vertices[indices[i + 1]].position,
+			vertices[indices[i + 2]].position));
+	if(hullArea <= 0.0f || std::abs(trianglesArea - hullArea) > 1e-3f * hullArea)
+		return {};
+
+	return hull;
+}
+
+// Signed distance from a rectangle of half size with rounded corners, around its centre,
+// as in media/Hlms/Unlit/Any/RmlOgreRoundedClip_piece_all.any
+float rounded_rectangle_distance(
+	Rml::Vector2f offset,
+	Rml::Vector2f halfSize,
+	const Rml::Vector4f& radii)
+{
+	float radius = offset.y < 0.0f
+		? (offset.x < 0.0f ? radii.x : radii.y)
+		: (offset.x < 0.0f ? radii.w : radii.z);
+	Rml::Vector2f corner{
+		std::abs(offset.x) - halfSize.x + radius,
+		std::abs(offset.y) - halfSize.y + radius};
+	Rml::Vector2f outside{std::max(corner.x, 0.0f), std::max(corner.y, 0.0f)};
+	return outside.Magnitude() + std::min(std::max(corner.x, corner.y), 0.0f) - radius;
+}
+
+}
+
+Geometry nimble::RmlOgre::create_geometry(
+	Rml::Span<const Rml::Vertex> vertices,
+	Rml::Span<const int> indices)
+{
+	Geometry geometry;
+	geometry.vao = create_vao(vertices, indices);
+	geometry.vertices = vertices;
+	geometry.indices = indices;
+	if(!vertices.empty())
+	{
+		Rml::Vector2f min = vertices[0].position;
+		Rml::Vector2f max = vertices[0].position;
+		for(auto& v : vertices)
+		{
+			min.x = std::min(min.x, v.position.x);
+			min.y = std::min(min.y, v.position.y);
+			max.x = std::max(max.x, v.position.x);
+			max.y = std::max(max.y, v.position.y);
+			geometry.wrapsTexCoords = geometry.wrapsTexCoords
+				|| v.tex_coord.x < 0.0f || v.tex_coord.x > 1.0f
+				|| v.tex_coord.y < 0.0f || v.tex_coord.y > 1.0f;
+		}
+		geometry.bounds = Rml::Rectanglef::FromCorners(min, max);
+		geometry.isRectangle = is_rectangle(vertices, indices, geometry.bounds);
+	}
+
+	return geometry;
+}
+
+const std::vector<Rml::Vector2f>& nimble::RmlOgre::convex_hull(Geometry& geometry)
+{
+	if(!geometry.convexHull)
+		geometry.convexHull = find_convex_hull(geometry.vertices, geometry.indices);
+	return *geometry.convexHull;
+}
+
+bool nimble::RmlOgre::rounded_rectangle(Geometry& geometry, Rml::Vector4f& radii)
+{
+	if(geometry.isRectangle || !geometry.bounds.Valid())
+		return false;
+	const std::vector<Rml::Vector2f>& hull = convex_hull(geometry);
+	if(hull.empty())
+		return false;
+
+	const Rml::Rectanglef& bounds = geometry.bounds;
+	Rml::Vector2f size = bounds.Size();
+	float tolerance = 1e-3f * std::max(size.x, size.y) + 1e-3f;
+
+	// Top left, top right, bottom right and bottom left
+	std::array<Rml::Vector2f, 4> corners{
+		bounds.p0,
+		Rml::Vector2f{bounds.p1.x, bounds.p0.y},
+		bounds.p1,
+		Rml::Vector2f{bounds.p0.x, bounds.p1.y}};
+	// Where the corners' arcs meet the horizontal and vertical edges, from the corners
+	std::array<Rml::Vector2f, 4> arcs;
+	arcs.fill(size);
+	for(auto& p : hull)
+		for(std::size_t i = 0; i < corners.size(); ++i)
+		{
+			if(std::abs(p.y - corners[i].y) <= tolerance)
+				arcs[i].x = std::min(arcs[i].x, std::abs(p.x - corners[i].x));
+			if(std::abs(p.x - corners[i].x) <= tolerance)
+				arcs[i].y = std::min(arcs[i].y, std::abs(p.y - corners[i].y));
+		}
+	std::array<float, 4> r;
+	for(std::size_t i = 0; i < corners.size(); ++i)
+	{
+		// Elliptical corners aren't generated by Rml
+		if(std::abs(arcs[i].x - arcs[i].y) > tolerance)
+			return false;
+		r[i] = 0.5f * (arcs[i].x + arcs[i].y);
+	}
+	radii = Rml::Vector4f{r[0], r[1], r[2], r[3]};
+
+	Rml::Vector2f centre = (bounds.p0 + bounds.p1) * 0.5f;
+	for(auto& p : hull)
+		if(std::abs(rounded_rectangle_distance(p - centre, size * 0.5f, radii)) > tolerance)
+			return false;
+
+	// Hull vertices are all on the edge, so the hull is inside the rounded rectangle,
+	// it fills it when the corners are tessellated finely enough
+	float hullArea = 0.0f;
+	for(std::size_t i = 1; i + 1 < hull.size(); ++i)
+		hullArea += 0.5f * cross(hull[0], hull[i], hull[i + 1]);
+	float area = size.x * size.y;
+	for(float radius : r)
+		area -= (1.0f - 0.25f * Ogre::Math::PI) * radius * radius;
+	return std::abs(area - hullArea) <= 0.01f * area;
+}
@@ -1,8 +1,13 @@
 #ifndef NIMBLE_RMLOGRE_GEOMETRY_HPP
 #define NIMBLE_RMLOGRE_GEOMETRY_HPP
 
+#include <RmlUi/Core/Rectangle.h>
+#include <RmlUi/Core/Vector4.h>
 #include <RmlUi/Core/Vertex.h>
 
+#include <optional>
+#include <vector>
+
 
 namespace Ogre {
 
@@ -12,10 +17,47 @@ struct VertexArrayObject;
 
 namespace nimble::RmlOgre {
 
+struct Geometry
+{
+	Ogre::VertexArrayObject* vao = nullptr;
+	// Kept valid by Rml until the geometry is released
+	Rml::Span<const Rml::Vertex> vertices;
+	Rml::Span<const int> indices;
+	// Untransformed and untranslated vertex bounds, invalid if there are no vertices
+	Rml::Rectanglef bounds = Rml::Rectanglef::MakeInvalid();
+	// Triangles exactly cover bounds, so it can be clipped to with a scissor region
+	bool isRectangle = false;
+	// Texture coordinates outside [0, 1], sampled with wrapping
+	bool wrapsTexCoords = false;
+	// Set by convex_hull when first clipped to
+	std::optional<std::vector<Rml::Vector2f>> convexHull;
+};
+
+// Maximum vertices of geometry checked for being convex
+constexpr std::size_t MAX_HULL_VERTICES = 1024;
+
+// Positive when b is anticlockwise from a, around o
+inline float cross(Rml::Vector2f o, Rml::Vector2f a, Rml::Vector2f b)
+{
+	return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
 Ogre::VertexArrayObject* create_vao(
 	Rml::Span<const Rml::Vertex> vertices,
 	Rml::Span<const int> indices);
 
+Geometry create_geometry(
+	Rml::Span<const Rml::Vertex> vertices,
+	Rml::Span<const int> indices);
+
+// Hull vertices anticlockwise (in y up coordinates) if triangles fill their convex hull,
+// empty if they don't or there are too many vertices to check
+const std::vector<Rml::Vector2f>& convex_hull(Geometry& geometry);
+
+// Whether triangles fill bounds with rounded corners, as Rml generates for border-radius.
+// Radii are of the top left, top right, bottom right and bottom left corners.
+bool rounded_rectangle(Geometry& geometry, Rml::Vector4f& radii);
+
 }
 
 #endif // NIMBLE_RMLOGRE_GEOMETRY_HPP
@@ -8,6 +8,8 @@
 #include <RmlUi/Core/Dictionary.h>
 #include <RmlUi/Core/DecorationTypes.h>
 
+#include <vector>
+
 
 using namespace nimble::RmlOgre;
 
@@ -26,63 +28,125 @@ Ogre::Vector2 to_ogre(Rml::Vector2f v)
 	return Ogre::Vector2{v.x, v.y};
 }
 
+float smoothstep(float edge0, float edge1, float x)
+{
+	if(edge0 >= edge1)
+		return x < edge0 ? 0.0f : 1.0f;
+	float t = Ogre::Math::Clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+	return t * t * (3.0f - 2.0f * t);
+}
+
+// Stop colours over [start, start + range], blended with a smoothstep between each pair of stops
+std::vector<Ogre::uint8> make_lut(const Rml::ColorStopList& stopList, float start, float range)
+{
+	constexpr std::uint32_t WIDTH = GradientAtlas::LUT_WIDTH;
+	std::vector<Ogre::uint8> texels(WIDTH * 4, 0);
+	if(stopList.empty())
+		return texels;
+
+	for(std::uint32_t i = 0; i < WIDTH; ++i)
+	{
+		float t = start + range * i / (WIDTH - 1);
+		Ogre::Vector4 colour = to_ogre(stopList[0].color);
+		for(std::size_t j = 1; j < stopList.size(); ++j)
+		{
+			float weight = smoothstep(stopList[j - 1].position.number, stopList[j].position.number, t);
+			colour += (to_ogre(stopList[j].color) - colour) * weight;
+		}
+
+		for(int k = 0; k < 4; ++k)
+			texels[i * 4 + k] = static_cast<Ogre::uint8>(
+				Ogre::Math::Clamp(colour[k], 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+	return texels;
+}
+
 }
 
 
-GradientMaker::GradientMaker(GradientMaker::Type type) :
-	type{type}
+GradientMaker::GradientMaker(GradientMaker::Type type, GradientAtlas& atlas) :
+	atlas{atlas}
+{
+	static const std::array<std::array<const char*, 2>, 3> MATERIAL_NAMES{{
+		{"Rml/LinearGradient", "Rml/RepeatingLinearGradient"},
+		{"Rml/RadialGradient", "Rml/RepeatingRadialGradient"},
+		{"Rml/ConicGradient", "Rml/RepeatingConicGradient"}
+	}};
+
+	for(std::size_t i = 0; i < this->baseMaterials.size(); ++i)
+	{
+		auto& material = this->baseMaterials[i];
+		material = Ogre::MaterialManager::getSingleton().getByName(MATERIAL_NAMES[int(type)][i]);
+		// Compile the programs now instead of on the first gradient
+		material->load();
+	}
+}
+
+const Ogre::MaterialPtr& GradientMaker::getPageMaterial(Ogre::TextureGpu* page, bool repeating)
 {
-	this->baseMaterial = Ogre::MaterialManager::getSingleton().getByName("Rml/Gradient");
+	auto& material = this->pageMaterials[{page, repeating}];
+	if(!material)
+	{
+		material = this->baseMaterials[repeating]->clone("");
+		material->load();
+		material
+			->getBestTechnique()
+			->getPass(0)
+			->getTextureUnitState("lutTex")
+			->setTexture(page);
+	}
+	return material;
 }
 
-Ogre::MaterialPtr GradientMaker::makeGradient(
+Material GradientMaker::makeGradient(
 	const Rml::Dictionary& parameters,
 	Ogre::Vector2& origin,
 	Ogre::Vector2& scale)
 {
-	auto material = this->baseMaterial->clone("");
-	material->load();
-	auto fragmentProgramParameters = material
-		->getBestTechnique()
-		->getPass(0)
-		->getFragmentProgramParameters();
-
-	fragmentProgramParameters->setNamedConstant("gradientType", int(this->type));
-	fragmentProgramParameters->setNamedConstant("repeating", int(Rml::Get(parameters, "repeating", false)));
-	fragmentProgramParameters->setNamedConstant("origin", origin);
-	fragmentProgramParameters->setNamedConstant("scale", scale);
-
 	auto stopListIter = parameters.find("color_stop_list");
 	assert(stopListIter  != parameters.end()
 		&& stopListIter ->second.GetType() == Rml::Variant::COLORSTOPLIST);
 	const Rml::ColorStopList& stopList = stopListIter->second.GetReference<Rml::ColorStopList>();
-	int stopListSize = stopList.size();
 
-	std::array<float, MAX_STOP_COLOURS> stopPositions;
-	std::array<float, MAX_STOP_COLOURS * 4> stopColours;
-	for(int i = 0, j = 0; i < stopListSize; ++i)
+	float start = 0.0f;
+	float range = 1.0f;
+	if(!stopList.empty())
 	{
-		stopPositions[i] = stopList[i].position.number;
-		auto colour = to_ogre(stopList[i].color);
-		for(int k = 0; k < 4; ++k)
-			stopColours[j++] = colour[k];
+		start = stopList.front().position.number;
+		range = stopList.back().position.number - start;
+		// Stops at one position, centre the step between them
+		if(range <= 0.0f)
+		{
+			start -= 0.5f;
+			range = 1.0f;
+		}
 	}
 
-	fragmentProgramParameters->setNamedConstant("numStops", stopListSize);
-	fragmentProgramParameters->setNamedConstant(
-		"stopPositions",
-		stopPositions.data(),
-		4);
-	fragmentProgramParameters->setNamedConstant(
-		"stopColours",
-		stopColours.data(),
-		stopColours.size() / 4);
+	auto lut = this->atlas.add(make_lut(stopList, start, range));
+	bool repeating = Rml::Get(parameters, "repeating", false);
 
-	return material;
+	// Must match the custom auto parameters in media/scripts/materials/Rml/Gradient.material
+	Material shader{this->getPageMaterial(lut.texture, repeating)};
+	shader.customParameters[0] = Ogre::Vector4{origin.x, origin.y, scale.x, scale.y};
+	shader.customParameters[1] = Ogre::Vector4{start, 1.0f / range, lut.v(), 0.0f};
+	shader.numCustomParameters = 2;
+	return shader;
+}
+
+
+void GradientMaker::release(const Material& shader)
+{
+	for(auto& pageMaterial : this->pageMaterials)
+		if(pageMaterial.second == shader.material)
+		{
+			auto row = static_cast<std::uint32_t>(shader.customParameters[1].z * GradientAtlas::PAGE_ROWS);
+			this->atlas.release(GradientAtlas::Lut{pageMaterial.first.first, row});
+			return;
+		}
 }
 
 
-Ogre::MaterialPtr LinearGradientMaker::make(const Rml::Dictionary& parameters)
+Material LinearGradientMaker::make(const Rml::Dictionary& parameters)
 {
 	auto p0 = Rml::Get(parameters, "p0", Rml::Vector2f(0.0f));
 	auto p1 = Rml::Get(parameters, "p1", Rml::Vector2f(0.0f));
@@ -91,7 +155,7 @@ Ogre::MaterialPtr LinearGradientMaker::make(const Rml::Dictionary& parameters)
 	return this->makeGradient(parameters, origin, scale);
 }
 
-Ogre::MaterialPtr RadialGradientMaker::make(const Rml::Dictionary& parameters)
+Material RadialGradientMaker::make(const Rml::Dictionary& parameters)
 {
 	auto center = Rml::Get(parameters, "center", Rml::Vector2f(0.0f));
 	auto radius = Rml::Get(parameters, "radius", Rml::Vector2f(1.0f));
@@ -100,7 +164,7 @@ Ogre::MaterialPtr RadialGradientMaker::make(const Rml::Dictionary& parameters)
 	return this->makeGradient(parameters, origin, scale);
 }
 
-Ogre::MaterialPtr ConicGradientMaker::make(const Rml::Dictionary& parameters)
+Material ConicGradientMaker::make(const Rml::Dictionary& parameters)
 {
 	auto center = Rml::Get(parameters, "center", Rml::Vector2f(0.0f));
 	auto angle = Rml::Get(parameters, "angle", 0.0f);
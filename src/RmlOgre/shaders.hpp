@@ -1,8 +1,13 @@
 #ifndef NIMBLE_RMLOGRE_SHADERS_HPP
 #define NIMBLE_RMLOGRE_SHADERS_HPP
 
+#include "GradientAtlas.hpp"
 #include "ShaderMaker.hpp"
 
+#include <array>
+#include <map>
+#include <utility>
+
 
 namespace nimble::RmlOgre {
 
@@ -16,49 +21,50 @@ public:
 		CONIC
 	};
 
-	// Must be same as:
-	// MAX_STOP_COLOURS in media/scripts/material/Rml/GLSL/Gradient_ps.glsl
-	// MAX_STOP_COLOURS in media/scripts/material/Rml/HLSL/Gradient_ps.hlsl
-	static const int MAX_STOP_COLOURS = 16;
-
 private:
-	Type type;
-	Ogre::MaterialPtr baseMaterial;
+	// Specialised for the gradient type, without and with repeating
+	std::array<Ogre::MaterialPtr, 2> baseMaterials;
+	GradientAtlas& atlas;
+	// Shared by all gradients with their lookup table in an atlas page
+	std::map<std::pair<Ogre::TextureGpu*, bool>, Ogre::MaterialPtr> pageMaterials;
+
+	const Ogre::MaterialPtr& getPageMaterial(Ogre::TextureGpu* page, bool repeating);
 
 public:
-	GradientMaker(Type type);
-	Ogre::MaterialPtr makeGradient(
+	GradientMaker(Type type, GradientAtlas& atlas);
+	Material makeGradient(
 		const Rml::Dictionary& parameters,
 		Ogre::Vector2& origin,
 		Ogre::Vector2& scale);
+	void release(const Material& shader) override;
 };
 
 
 class LinearGradientMaker : public GradientMaker
 {
 public:
-	LinearGradientMaker() :
-		GradientMaker(GradientMaker::Type::LINEAR)
+	LinearGradientMaker(GradientAtlas& atlas) :
+		GradientMaker(GradientMaker::Type::LINEAR, atlas)
 	{}
-	Ogre::MaterialPtr make(const Rml::Dictionary& parameters) override;
+	Material make(const Rml::Dictionary& parameters) override;
 };
 
 class RadialGradientMaker : public GradientMaker
 {
 public:
-	RadialGradientMaker() :
-		GradientMaker(GradientMaker::Type::RADIAL)
+	RadialGradientMaker(GradientAtlas& atlas) :
+		GradientMaker(GradientMaker::Type::RADIAL, atlas)
 	{}
-	Ogre::MaterialPtr make(const Rml::Dictionary& parameters) override;
+	Material make(const Rml::Dictionary& parameters) override;
 };
 
 class ConicGradientMaker : public GradientMaker
 {
 public:
-	ConicGradientMaker() :
-		GradientMaker(GradientMaker::Type::CONIC)
+	ConicGradientMaker(GradientAtlas& atlas) :
+		GradientMaker(GradientMaker::Type::CONIC, atlas)
 	{}
-	Ogre::MaterialPtr make(const Rml::Dictionary& parameters) override;
+	Material make(const Rml::Dictionary& parameters) override;
 };
 
 }